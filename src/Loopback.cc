@@ -0,0 +1,433 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Real-time run of the UDP congestion controller over Linux UDP sockets.
+ *
+ * The sender and the receiver use the same UdpCcController, UdpCcHeader and
+ * PacketLossCounter as UdpClient/UdpServer, but exchange real datagrams on
+ * loopback (or any local address, e.g. the two ends of a veth pair). A
+ * user-space shaper between them emulates the bottleneck link: a drop-tail
+ * queue drained at a fixed rate followed by a fixed propagation delay. The
+ * feedback returns directly from the receiver to the sender.
+ *
+ *   sender --> shaper (rate, delay, queue) --> receiver
+ *      ^                                          |
+ *      +------------------ feedback --------------+
+ *
+ * With --burst, the sender sends that many packets back to back every
+ * controller interval, and the controller works in bursts as UdpClient with
+ * AdaptiveSize works in packets of PacketSize: the interval paces bursts and
+ * losses are reported in bursts. The sockets then see batches large enough
+ * for GSO/sendmmsg to matter at rates the interval bounds of the controller
+ * would otherwise cap at one packet per 200 us.
+ *
+ * The shaper runs in its own thread and uses plain integer nanoseconds, as
+ * ns-3 objects are not thread-safe. The sender and the receiver share the
+ * main thread. The CPU time of the main thread and of the shaper is reported
+ * separately, as only the former is the cost of the controller and sockets.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/packet-loss-counter.h"
+#include "ns3/udp-cc-header.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#define BATCH_LIMIT 64
+#define MAX_DATAGRAM 2048
+#define SHAPER_SLOTS 8192
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE("Loopback");
+
+static atomic<bool> running(true);
+
+// Wall clock in ns, CLOCK_REALTIME to match the kernel software receive timestamps
+int64_t WallClock(void) {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// User and system CPU time of the calling thread in s
+double ThreadCpu(void) {
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Wait until one of the sockets is readable or the timeout (ns) expires
+bool WaitReadable(pollfd *fds, uint32_t count, int64_t timeout) {
+    timeout = max<int64_t>(timeout, 0);
+    timespec ts;
+    ts.tv_sec = timeout / 1000000000;
+    ts.tv_nsec = timeout % 1000000000;
+    return ppoll(fds, count, &ts, 0) > 0;
+}
+
+sockaddr_in LocalAddress(string address, uint16_t port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, address.c_str(), &addr.sin_addr);
+    return addr;
+}
+
+int OpenSocket(sockaddr_in addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        NS_FATAL_ERROR("Failed to bind socket to port " << ntohs(addr.sin_port) << ": " << strerror(errno));
+    }
+    int bufferSize = 1 << 22;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    return fd;
+}
+
+void WriteHeader(const UdpCcHeader &header, uint8_t *buf) {
+    Buffer buffer;
+    buffer.AddAtStart(header.GetSerializedSize());
+    header.Serialize(buffer.Begin());
+    buffer.CopyData(buf, header.GetSerializedSize());
+}
+
+void ReadHeader(UdpCcHeader &header, const uint8_t *buf) {
+    Buffer buffer;
+    buffer.AddAtStart(header.GetSerializedSize());
+    buffer.Begin().Write(buf, header.GetSerializedSize());
+    header.Deserialize(buffer.Begin());
+}
+
+// Kernel software receive timestamp of a datagram, the wall clock when there is none
+int64_t ReceiveTimestamp(msghdr *hdr) {
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg != 0; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            scm_timestamping *ts = (scm_timestamping *) CMSG_DATA(cmsg);
+            return (int64_t) ts->ts[0].tv_sec * 1000000000 + ts->ts[0].tv_nsec;
+        }
+    }
+    return WallClock();
+}
+
+struct ShaperStats {
+    atomic<uint64_t> forwarded;
+    atomic<uint64_t> dropped;
+    double cpu; // CPU time of the shaper thread in s, set when it exits
+};
+
+// Bottleneck link: drop-tail queue of queueBytes drained at rate bit/s, then delay ns
+void RunShaper(int fd, sockaddr_in receiver, uint64_t rate, int64_t delay, uint32_t queueBytes, ShaperStats *stats) {
+    struct Slot {
+        uint8_t data[MAX_DATAGRAM];
+        uint32_t size;
+        int64_t release;
+    };
+    vector<Slot> ring(SHAPER_SLOTS);
+    uint32_t head = 0, count = 0;
+    int64_t linkFree = WallClock();
+
+    static uint8_t scratch[BATCH_LIMIT][MAX_DATAGRAM];
+    mmsghdr msgs[BATCH_LIMIT];
+    iovec iovs[BATCH_LIMIT];
+    pollfd pfd = { fd, POLLIN, 0 };
+    double cpuStart = ThreadCpu();
+
+    while (running) {
+        // Release every packet whose delivery time has come in one batch
+        int64_t now = WallClock();
+        uint32_t released = 0;
+        memset(msgs, 0, sizeof(msgs));
+        while (released < count && released < BATCH_LIMIT && ring[(head + released) % SHAPER_SLOTS].release <= now) {
+            Slot &slot = ring[(head + released) % SHAPER_SLOTS];
+            iovs[released].iov_base = slot.data;
+            iovs[released].iov_len = slot.size;
+            msgs[released].msg_hdr.msg_iov = &iovs[released];
+            msgs[released].msg_hdr.msg_iovlen = 1;
+            msgs[released].msg_hdr.msg_name = &receiver;
+            msgs[released].msg_hdr.msg_namelen = sizeof(receiver);
+            released++;
+        }
+        if (released > 0) {
+            int sent = sendmmsg(fd, msgs, released, 0);
+            sent = max(sent, 0);
+            stats->forwarded += sent;
+            stats->dropped += released - sent;
+            head = (head + released) % SHAPER_SLOTS;
+            count -= released;
+            continue;
+        }
+
+        int64_t wait = count > 0 ? ring[head].release - now : 10000000;
+        if (!WaitReadable(&pfd, 1, wait)) {
+            continue;
+        }
+
+        memset(msgs, 0, sizeof(msgs));
+        for (uint32_t i = 0; i < BATCH_LIMIT; i++) {
+            iovs[i].iov_base = scratch[i];
+            iovs[i].iov_len = MAX_DATAGRAM;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(fd, msgs, BATCH_LIMIT, MSG_DONTWAIT, 0);
+        now = WallClock();
+        for (int i = 0; i < received; i++) {
+            uint32_t size = msgs[i].msg_len;
+
+            // Bytes still waiting for the link when this packet arrives
+            uint64_t backlog = linkFree > now ? (linkFree - now) * rate / 8000000000ULL : 0;
+            if (backlog + size > queueBytes || count == SHAPER_SLOTS) {
+                stats->dropped++;
+                continue;
+            }
+            linkFree = max(linkFree, now) + (int64_t) size * 8000000000ULL / rate;
+
+            Slot &slot = ring[(head + count) % SHAPER_SLOTS];
+            memcpy(slot.data, scratch[i], size);
+            slot.size = size;
+            slot.release = linkFree + delay;
+            count++;
+        }
+    }
+    stats->cpu = ThreadCpu() - cpuStart;
+}
+
+int main(int argc, char *argv[]) {
+    string address = "127.0.0.1";
+    uint16_t basePort = 9000;
+    string bandwidth = "20Mbps";
+    string linkDelay = "10ms";
+    uint32_t queueSize = 50; // Packets of packetSize, as the 50p queues of PersonalProject
+    uint32_t packetSize = 1000;
+    double duration = 10;
+    bool gso = true;
+    uint32_t burst = 1;
+    CommandLine cmd;
+    cmd.AddValue("address", "Local address of the sockets, e.g. of a veth pair", address);
+    cmd.AddValue("port", "First of the three ports used by the shaper, receiver and sender", basePort);
+    cmd.AddValue("bandwidth", "Bottleneck rate of the shaper", bandwidth);
+    cmd.AddValue("delay", "Propagation delay of the shaper", linkDelay);
+    cmd.AddValue("queue", "Queue size of the shaper in packets", queueSize);
+    cmd.AddValue("size", "Packet size in bytes", packetSize);
+    cmd.AddValue("duration", "Run time in seconds", duration);
+    cmd.AddValue("gso", "Send batches with UDP GSO when the kernel supports it, otherwise with sendmmsg", gso);
+    cmd.AddValue("burst", "Packets sent back to back per controller interval", burst);
+    cmd.Parse(argc, argv);
+
+    UdpCcHeader header;
+    const uint32_t headerSize = header.GetSerializedSize();
+    packetSize = max(min<uint32_t>(packetSize, MAX_DATAGRAM), headerSize);
+    const uint32_t batchLimit = min<uint32_t>(BATCH_LIMIT, 65000 / packetSize);
+    burst = max<uint32_t>(1, min(burst, batchLimit));
+
+    sockaddr_in shaperAddress = LocalAddress(address, basePort);
+    sockaddr_in receiverAddress = LocalAddress(address, basePort + 1);
+    sockaddr_in senderAddress = LocalAddress(address, basePort + 2);
+    int shaperSocket = OpenSocket(shaperAddress);
+    int receiverSocket = OpenSocket(receiverAddress);
+    int senderSocket = OpenSocket(senderAddress);
+
+    int timestamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(receiverSocket, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping)) < 0) {
+        NS_LOG_UNCOND("(LOOP) SO_TIMESTAMPING not available, receive times from the wall clock");
+    }
+    if (gso && setsockopt(senderSocket, SOL_UDP, UDP_SEGMENT, &packetSize, sizeof(packetSize)) < 0) {
+        NS_LOG_UNCOND("(LOOP) UDP GSO not available, batches sent with sendmmsg");
+        gso = false;
+    }
+
+    ShaperStats shaperStats;
+    shaperStats.forwarded = 0;
+    shaperStats.dropped = 0;
+    shaperStats.cpu = 0;
+    thread shaper(&RunShaper, shaperSocket, receiverAddress, DataRate(bandwidth).GetBitRate(),
+                  Time(linkDelay).GetNanoSeconds(), queueSize * packetSize, &shaperStats);
+
+    Ptr<UdpCcController> controller = CreateObject<UdpCcController>();
+    PacketLossCounter lossCounter(0);
+    lossCounter.SetBitMapSize(32);
+
+    vector<uint8_t> sendBuffer(BATCH_LIMIT * packetSize, 0);
+    static uint8_t recvBuffer[BATCH_LIMIT][MAX_DATAGRAM];
+    static uint8_t control[BATCH_LIMIT][256];
+    mmsghdr msgs[BATCH_LIMIT];
+    iovec iovs[BATCH_LIMIT];
+    pollfd fds[2] = { { senderSocket, POLLIN, 0 }, { receiverSocket, POLLIN, 0 } };
+
+    uint64_t sent = 0, batches = 0, received = 0, receivedBytes = 0, feedbacks = 0;
+    int64_t totalDelay = 0, lastFeedback = 0;
+    uint32_t seq = 0;
+
+    double cpuStart = ThreadCpu();
+    int64_t start = WallClock();
+    int64_t end = start + (int64_t) (duration * 1e9);
+    int64_t nextSend = start;
+
+    for (int64_t now = start; now < end; now = WallClock()) {
+        // Sender: bursts due since the last wakeup go out in one batch
+        int64_t interval = controller->GetInterval().GetNanoSeconds();
+        uint32_t due = 0;
+        while (nextSend <= now && due + burst <= batchLimit) {
+            nextSend += interval;
+            due += burst;
+        }
+        if (due > 0) {
+            for (uint32_t i = 0; i < due; i++) {
+                header.SetSeq(seq++);
+                header.SetTs(NanoSeconds(now));
+                header.SetInterval(NanoSeconds(interval));
+                WriteHeader(header, &sendBuffer[i * packetSize]);
+            }
+
+            int result;
+            memset(msgs, 0, sizeof(msgs));
+            if (gso) {
+                // One datagram per packetSize bytes, segmented by the kernel
+                iovs[0].iov_base = &sendBuffer[0];
+                iovs[0].iov_len = due * packetSize;
+                msgs[0].msg_hdr.msg_iov = &iovs[0];
+                msgs[0].msg_hdr.msg_iovlen = 1;
+                msgs[0].msg_hdr.msg_name = &shaperAddress;
+                msgs[0].msg_hdr.msg_namelen = sizeof(shaperAddress);
+                result = sendmsg(senderSocket, &msgs[0].msg_hdr, 0) < 0 ? 0 : due;
+            } else {
+                for (uint32_t i = 0; i < due; i++) {
+                    iovs[i].iov_base = &sendBuffer[i * packetSize];
+                    iovs[i].iov_len = packetSize;
+                    msgs[i].msg_hdr.msg_iov = &iovs[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                    msgs[i].msg_hdr.msg_name = &shaperAddress;
+                    msgs[i].msg_hdr.msg_namelen = sizeof(shaperAddress);
+                }
+                result = max(sendmmsg(senderSocket, msgs, due, 0), 0);
+            }
+            sent += result;
+            batches++;
+        }
+        // No burst to catch up after a stall of the process
+        nextSend = max(nextSend, now - interval);
+
+        if (!WaitReadable(fds, 2, nextSend - WallClock())) {
+            continue;
+        }
+
+        // Receiver: account the packets, feedback every UDP_CC_FEEDBACK_PERIOD ms to the sender, as UdpServer
+        memset(msgs, 0, sizeof(msgs));
+        for (uint32_t i = 0; i < BATCH_LIMIT; i++) {
+            iovs[i].iov_base = recvBuffer[i];
+            iovs[i].iov_len = MAX_DATAGRAM;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+        int count = recvmmsg(receiverSocket, msgs, BATCH_LIMIT, MSG_DONTWAIT, 0);
+        for (int i = 0; i < count; i++) {
+            if (msgs[i].msg_len < headerSize) {
+                continue;
+            }
+            int64_t recvTime = ReceiveTimestamp(&msgs[i].msg_hdr);
+            ReadHeader(header, recvBuffer[i]);
+            received++;
+            receivedBytes += msgs[i].msg_len;
+            totalDelay += recvTime - header.GetTs().GetNanoSeconds();
+            lossCounter.NotifyReceived(header.GetSeq());
+
+            if (recvTime - lastFeedback > UDP_CC_FEEDBACK_PERIOD * 1000000LL) {
+                lastFeedback = recvTime;
+                uint8_t feedback[64];
+                message_t msg;
+                msg.recvTime = NanoSeconds(recvTime).GetInteger();
+                msg.lost = lossCounter.GetLost();
+                msg.ce = 0;
+                WriteHeader(header, feedback);
+                memcpy(feedback + headerSize, msg.buf, 16);
+                sendto(receiverSocket, feedback, headerSize + 16, 0, (sockaddr *) &senderAddress, sizeof(senderAddress));
+            }
+        }
+
+        // Sender: feed the controller
+        memset(msgs, 0, sizeof(msgs));
+        for (uint32_t i = 0; i < BATCH_LIMIT; i++) {
+            iovs[i].iov_base = recvBuffer[i];
+            iovs[i].iov_len = MAX_DATAGRAM;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        count = recvmmsg(senderSocket, msgs, BATCH_LIMIT, MSG_DONTWAIT, 0);
+        for (int i = 0; i < count; i++) {
+            if (msgs[i].msg_len < headerSize + 16) {
+                continue;
+            }
+            message_t msg;
+            ReadHeader(header, recvBuffer[i]);
+            memcpy(msg.buf, recvBuffer[i] + headerSize, 16);
+            // The controller counts in bursts, the unit its interval paces
+            controller->OnFeedback(msg.lost / burst, msg.ce / burst, header.GetSeq() / burst, header.GetTs(), Time(msg.recvTime), header.GetInterval());
+            feedbacks++;
+        }
+    }
+
+    int64_t elapsed = WallClock() - start;
+    double cpu = ThreadCpu() - cpuStart; // Sender and receiver, the shaper runs in its own thread
+    running = false;
+    shaper.join();
+    close(shaperSocket);
+    close(receiverSocket);
+    close(senderSocket);
+
+    double seconds = elapsed / 1e9;
+    double gbits = receivedBytes * 8 / 1e9;
+
+    NS_LOG_UNCOND("(LOOP) Sent " << sent << " packets, " << (uint64_t) (sent / seconds) << " pps, " <<
+                  batches << " batches of " << (batches > 0 ? (double) sent / batches : 0) << " packets on average (" <<
+                  (gso ? "GSO" : "sendmmsg") << ", burst " << burst << ")");
+    NS_LOG_UNCOND("(LOOP) Received " << received << " packets, " << (uint64_t) (received / seconds) << " pps");
+    NS_LOG_UNCOND("(LOOP) Throughput " << (receivedBytes * 8) / (seconds * 1000) << " Kbps");
+    NS_LOG_UNCOND("(LOOP) Delay " << (received > 0 ? totalDelay / (int64_t) received / 1000000 : 0) << " ms");
+    NS_LOG_UNCOND("(LOOP) Lost " << lossCounter.GetLost() << " Shaper dropped " << shaperStats.dropped <<
+                  " forwarded " << shaperStats.forwarded);
+    NS_LOG_UNCOND("(LOOP) Feedback " << feedbacks << " Final interval " << controller->GetInterval().GetMicroSeconds() << " us");
+    NS_LOG_UNCOND("(LOOP) CPU " << cpu << " s, " << (gbits > 0 ? cpu / gbits : 0) << " s per Gbit (sender and receiver)");
+    NS_LOG_UNCOND("(LOOP) Shaper CPU " << shaperStats.cpu << " s");
+    return 0;
+}
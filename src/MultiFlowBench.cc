@@ -0,0 +1,171 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Cost of many UDP cc flows from one host: N UdpClient applications against
+ * one UdpMultiClient driving the same N flows.
+ *
+ *   client --- router --- server (one UdpServer per flow)
+ *
+ * Both modes send the same packets to the same servers. The wall-clock time
+ * of Simulator::Run and the resident memory of the applications are reported.
+ *
+ * With shared_server, one multiplexed UdpServer serves all UdpClient flows on
+ * a single port instead of one server per flow.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/udp-multi-client.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE("MultiFlowBench");
+
+// Resident set size and its peak in kB
+void ReadResidentMemory(uint64_t &rss, uint64_t &peak) {
+    rss = peak = 0;
+    ifstream status("/proc/self/status");
+    string key;
+    uint64_t value;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> value) {
+            rss = value;
+        } else if (key == "VmHWM:" && status >> value) {
+            peak = value;
+        }
+    }
+}
+
+// Resident set size once the applications have started and opened their sockets
+void ReadStartedMemory(uint64_t *rss) {
+    uint64_t peak;
+    ReadResidentMemory(*rss, peak);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t flowNum = 100;
+    bool multi = true;
+    bool sharedServer = false;
+    uint32_t packetSize = 1000;
+    uint32_t maxPackets = 500000000;
+    uint32_t duration = 10;
+    string bandwidth = "10Gbps";
+    CommandLine cmd;
+    cmd.AddValue("flows", "Number of UDP flows from the client host", flowNum);
+    cmd.AddValue("multi", "Drive the flows with one UdpMultiClient instead of one UdpClient each", multi);
+    cmd.AddValue("shared_server", "Serve all flows from one multiplexed UdpServer port", sharedServer);
+    cmd.AddValue("size", "Packet size in bytes", packetSize);
+    cmd.AddValue("duration", "Simulation time in seconds", duration);
+    cmd.AddValue("bandwidth", "Rate of both links", bandwidth);
+    cmd.Parse(argc, argv);
+    if (multi && sharedServer) {
+        // Flows of a UdpMultiClient share its socket, so one server port could not tell them apart
+        NS_FATAL_ERROR("shared_server needs a UdpClient per flow (multi=0)");
+    }
+
+    NodeContainer nodes;
+    nodes.Create(3);
+    InternetStackHelper internet;
+    internet.SetIpv6StackInstall(false);
+    internet.Install(nodes);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(bandwidth));
+    p2p.SetChannelAttribute("Delay", StringValue("1ms"));
+    TrafficControlHelper tch;
+    tch.SetRootQueueDisc("ns3::PfifoFastQueueDisc", "MaxSize", QueueSizeValue(QueueSize("1000p")));
+
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.255.255.0");
+    NetDeviceContainer access = p2p.Install(nodes.Get(0), nodes.Get(1));
+    tch.Install(access);
+    address.Assign(access);
+    address.NewNetwork();
+    NetDeviceContainer bottleneck = p2p.Install(nodes.Get(1), nodes.Get(2));
+    tch.Install(bottleneck);
+    Ipv4Address serverAddress = address.Assign(bottleneck).GetAddress(1);
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+    uint64_t rssStart, rssApps, rssEnd, rssPeak;
+    ReadResidentMemory(rssStart, rssPeak);
+
+    vector< Ptr<UdpServer> > servers;
+    for (uint32_t i = 0; i < (sharedServer ? 1 : flowNum); i++) {
+        Ptr<UdpServer> server = CreateObject<UdpServer>();
+        server->SetAttribute("Port", UintegerValue(10000 + i));
+        server->SetAttribute("Multiplex", BooleanValue(sharedServer));
+        nodes.Get(2)->AddApplication(server);
+        servers.push_back(server);
+    }
+
+    if (multi) {
+        Ptr<UdpMultiClient> client = CreateObject<UdpMultiClient>();
+        client->SetAttribute("PacketSize", UintegerValue(packetSize));
+        for (uint32_t i = 0; i < flowNum; i++) {
+            client->AddFlow(serverAddress, 10000 + i, maxPackets);
+        }
+        nodes.Get(0)->AddApplication(client);
+    } else {
+        for (uint32_t i = 0; i < flowNum; i++) {
+            Ptr<UdpClient> client = CreateObject<UdpClient>();
+            client->SetRemote(serverAddress, sharedServer ? 10000 : 10000 + i);
+            client->SetAttribute("MaxPackets", UintegerValue(maxPackets));
+            client->SetAttribute("PacketSize", UintegerValue(packetSize));
+            nodes.Get(0)->AddApplication(client);
+        }
+    }
+
+    // Applications start at 0, so a time step later their sockets exist
+    Simulator::Schedule(TimeStep(1), &ReadStartedMemory, &rssApps);
+
+    SystemWallClockMs clock;
+    clock.Start();
+    Simulator::Stop(Seconds(duration));
+    Simulator::Run();
+    int64_t runTime = clock.End();
+    ReadResidentMemory(rssEnd, rssPeak);
+
+    uint64_t received = 0, totalRx = 0;
+    for (vector< Ptr<UdpServer> >::iterator iter = servers.begin(); iter != servers.end(); iter++) {
+        received += (*iter)->GetReceived();
+        totalRx += (*iter)->GetTotalRx();
+    }
+
+    NS_LOG_UNCOND("(BENCH) Mode: " << (multi ? "UdpMultiClient" : "UdpClient") << ", " << flowNum << " flows, " <<
+                  servers.size() << " servers");
+    if (sharedServer) {
+        NS_LOG_UNCOND("(BENCH) Senders: " << servers[0]->GetSourceCount() << ", lost " << servers[0]->GetLost());
+    }
+    NS_LOG_UNCOND("(BENCH) Wall-clock: " << runTime << " ms");
+    NS_LOG_UNCOND("(BENCH) Packets: " << received << " (" << (runTime > 0 ? received * 1000 / runTime : 0) << " per wall-clock second)");
+    NS_LOG_UNCOND("(BENCH) Throughput: " << (totalRx * 8) / (duration * 1000.0) << " Kbps");
+    NS_LOG_UNCOND("(BENCH) Memory: " << rssApps - rssStart << " kB for the started applications, " <<
+                  rssEnd - rssStart << " kB after the run (peak " << rssPeak << " kB)");
+
+    Simulator::Destroy();
+    return 0;
+}
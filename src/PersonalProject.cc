@@ -35,7 +35,18 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <sstream>
 #include <list>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -48,8 +59,15 @@
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/tcp-req-resp.h"
 
 #define LOG_INTERVAL 100
+#define DYNAMIC_PORT_SPAN 1000
+#define METRICS_BATCH 1024 // Flow records per metrics datagram
+#define AUTO_STOP_PERIOD 100 // ms between the checks of auto_stop and converge_window
+#define FLIGHT_MAX_HOPS 8 // Queue discs recorded along the path of a packet
+#define LINK_BOTTLENECK_UTILIZATION 0.9 // Links busier than this are reported as bottlenecks
 
 using namespace ns3;
 using namespace std;
@@ -90,6 +108,1507 @@ void LogUdpTargetInterval(string flowNum, Time oldValue, Time newValue) {
     NS_LOG_UNCOND(Simulator::Now().GetSeconds() << " s > target " << flowNum << "(udp) " << newValue.GetMicroSeconds());
 }
 
+void LogUdpCe(string flowNum, uint32_t oldValue, uint32_t newValue) {
+    NS_LOG_UNCOND(Simulator::Now().GetSeconds() << " s > ce " << flowNum << "(udp) " << newValue);
+}
+
+void LogUdpDecision(string flowNum, const UdpCcDecision &decision) {
+    NS_LOG_UNCOND(Simulator::Now().GetSeconds() << " s > decision " << flowNum << "(udp) " <<
+                  UdpCcController::GetDecisionName(decision.reason) <<
+                  " delay " << decision.delay.GetMicroSeconds() << " [" << decision.delayMin.GetMicroSeconds() <<
+                  ", " << decision.delayMax.GetMicroSeconds() << "] us" <<
+                  " slope " << decision.trendlineSlope << " lost " << decision.lost << " ce " << decision.ce <<
+                  " interval " << decision.oldInterval.GetMicroSeconds() << " -> " << decision.newInterval.GetMicroSeconds() << " us");
+}
+
+#define PROFILE_BULK     0
+#define PROFILE_ONOFF    1
+#define PROFILE_REQRESP  2
+
+// Congestion control and traffic pattern of TCP flows, shared by the flow_file entries with the same options
+struct TrafficProfile {
+    uint8_t kind;
+    TypeId tcpVariant;
+    string name; // Options of the entries, empty for the default bulk NewReno profile
+    string rate; // On/off: sending rate during on periods
+    double onTime; // On/off: mean on period (s)
+    double offTime; // On/off: mean off period (s)
+    uint32_t requestSize; // Request/response: bytes
+    uint32_t responseSize; // Request/response: bytes
+    double thinkTime; // Request/response: mean time from a response to the next request (s)
+};
+
+static vector<TrafficProfile> trafficProfiles;
+
+// Source of short-lived flows described by a single flow_file entry with an arrival process
+struct FlowGenerator {
+    uint32_t entry; // Index of the flow_file entry
+    bool udp;
+    uint16_t profile;
+    bool poisson; // Poisson arrivals, otherwise an on/off source with one flow per on period
+    uint32_t src;
+    uint32_t dst;
+    uint16_t basePort;
+    uint32_t nextPort;
+    set<uint16_t> activePorts;
+    double meanPackets;
+    double sizeShape; // Pareto shape of the flow size, fixed size when <= 1
+    Time stopTime;
+    Ptr<ExponentialRandomVariable> gap; // Inter-arrival time (Poisson) or off period (on/off)
+    Ptr<UniformRandomVariable> size;
+};
+
+#define FLOW_UDP        0x01
+#define FLOW_GENERATED  0x02
+#define FLOW_STARTED    0x04
+#define FLOW_FINISHED   0x08
+#define FLOW_TIMED_OUT  0x10
+
+// Results of a subflow of a multipath UDP flow
+struct PathReport {
+    uint64_t rxBytes;
+    int64_t delay; // Average delay in time steps
+    uint32_t lost;
+};
+
+// Per-flow details of the report of a UDP flow listed in flow_file, kept once its applications are released
+struct UdpFlowReport {
+    int64_t feedbackDelay; // Time steps
+    int64_t intervalDeviation; // Time steps
+    uint32_t capBlocked;
+    uint32_t feedbackTimeouts;
+    uint32_t averagePacketSize;
+    uint32_t decisionCount[UdpCcController::DECISION_REASONS]; // Summed over the subflows
+    int64_t decisionDelta[UdpCcController::DECISION_REASONS]; // Time steps, summed over the subflows
+    uint32_t frames;
+    uint32_t framesOnTime;
+    uint32_t framesLate;
+    uint32_t skippedFrames;
+    int64_t frameLatency[3]; // P50, P95 and P99 in time steps
+    uint32_t stalls;
+    int64_t stallTime; // Time steps
+    vector<PathReport> paths; // Only with more than one subflow
+};
+
+// Metadata and results of every flow of the run, stored column-wise so that reporting
+// scans contiguous memory and a finished flow costs only one row
+struct FlowTable {
+    vector<uint8_t> flags;
+    vector<uint32_t> entry; // Index of the flow_file entry, the label of the flow in the report
+    vector<uint32_t> src;
+    vector<uint32_t> dst;
+    vector<uint16_t> port;
+    vector<uint16_t> profile; // Index of trafficProfiles, TCP only
+    vector<uint32_t> packets;
+    vector<int64_t> start; // Time steps
+    vector<int64_t> lastRx; // Time steps
+    vector<uint64_t> rxBytes;
+    vector<int64_t> delay; // Average delay in time steps, UDP only
+    vector<int64_t> delayP99; // 99th percentile delay in time steps, UDP only with delay_percentiles
+    vector<uint32_t> lost; // UDP only
+    vector<uint64_t> rxPackets; // UDP only
+    vector<uint64_t> delivered; // Bytes of distinct packets, reliable UDP only
+    vector<uint32_t> retransmitted; // Reliable UDP only
+    map<uint32_t, UdpFlowReport> udpReports; // By row, UDP flows listed in flow_file only
+
+    uint32_t Add(uint8_t flowFlags, uint32_t flowEntry, uint32_t flowSrc, uint32_t flowDst, uint16_t flowPort, uint16_t flowProfile,
+                 uint32_t flowPackets, Time flowStart) {
+        flags.push_back(flowFlags);
+        entry.push_back(flowEntry);
+        src.push_back(flowSrc);
+        dst.push_back(flowDst);
+        port.push_back(flowPort);
+        profile.push_back(flowProfile);
+        packets.push_back(flowPackets);
+        start.push_back(flowStart.GetTimeStep());
+        lastRx.push_back(flowStart.GetTimeStep());
+        rxBytes.push_back(0);
+        delay.push_back(0);
+        delayP99.push_back(0);
+        lost.push_back(0);
+        rxPackets.push_back(0);
+        delivered.push_back(0);
+        retransmitted.push_back(0);
+        return flags.size() - 1;
+    }
+
+    uint32_t GetSize(void) const {
+        return flags.size();
+    }
+
+    static uint32_t GetRowSize(void) {
+        return sizeof(uint8_t) + 3 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + sizeof(uint32_t) +
+               2 * sizeof(int64_t) + sizeof(uint64_t) + 2 * sizeof(int64_t) + sizeof(uint32_t) + sizeof(uint64_t) +
+               sizeof(uint64_t) + sizeof(uint32_t);
+    }
+};
+
+// Applications of a running flow, released as soon as the flow finishes
+struct ActiveFlow {
+    FlowGenerator *generator; // 0 for flows listed in flow_file
+    bool finishing;
+    Ptr<Application> server;
+    Ptr<Application> client;
+};
+
+static FlowTable flowTable;
+static list<FlowGenerator> flowGenerators;
+static map<uint32_t, ActiveFlow> activeFlows;
+static vector<Ptr<Node> > flowNodes;
+static vector<Ipv4Address> flowAddresses;
+static uint32_t peakActiveFlows = 0;
+static uint32_t rejectedFlows = 0;
+static uint32_t flowIdleTimeout = 1000; // ms without reception before a UDP flow is considered done
+static bool reliableUdp = false; // UDP flows retransmit lost packets and finish once everything is acknowledged
+static bool delayPercentiles = false; // UDP servers keep a delay histogram for the P99 delay
+static bool adaptivePacketSize = false; // UDP clients size packets to their rate, flow sizes stay in 1000-byte packets
+static uint32_t decisionLog = 0; // Log every Nth rate decision of static UDP flows, 0 for none
+static Ptr<UdpCcStateCache> stateCache; // Warm-start states of the UDP controllers per destination, 0 without warm_start
+
+// Received bytes of the receiving application of a TCP flow
+uint64_t GetTcpTotalRx(Ptr<Application> server) {
+    Ptr<PacketSink> sink = DynamicCast<PacketSink>(server);
+    return sink != 0 ? sink->GetTotalRx() : StaticCast<TcpReqRespClient>(server)->GetTotalRx();
+}
+
+// Point-to-point link of the topology, kept for per-path routing of multipath flows
+struct TopologyLink {
+    uint32_t node[2];
+    Ipv4Address address[2];
+    uint32_t ifIndex[2];
+};
+
+static vector<TopologyLink> topologyLinks;
+static vector< vector<uint32_t> > nodeLinks; // Indexes of the links attached to each node
+static uint32_t multipathCount = 1; // Subflows per static UDP flow
+static uint32_t nextPathAddress = 0;
+
+// Time-varying capacity and delay of a link, given as steps from the start of the trace
+struct LinkTrace {
+    vector<Time> at;
+    vector<uint64_t> rate; // bit/s
+    vector<Time> delay; // Negative keeps the link delay
+    Time period; // The trace repeats after its period, 0 holds the last step
+};
+
+// Link replaying a trace, with one scheduled event per step
+struct TracedLink {
+    Ptr<PointToPointNetDevice> device[2];
+    Ptr<PointToPointChannel> channel;
+    const LinkTrace *trace;
+};
+
+static map<string, LinkTrace> linkTraces;
+static vector<TracedLink> tracedLinks;
+
+// Mahimahi traces list one delivery opportunity of an MTU-sized packet per line (ms), and are
+// averaged over windows of step. Other traces list "time(s) rate [delay]" steps such as "2.5 6Mbps 40ms".
+const LinkTrace *LoadLinkTrace(string filename, Time step) {
+    string key = filename + "@" + to_string(step.GetTimeStep());
+    map<string, LinkTrace>::iterator cached = linkTraces.find(key);
+    if (cached != linkTraces.end()) {
+        return &cached->second;
+    }
+
+    ifstream file(filename.c_str());
+    if (!file) {
+        NS_FATAL_ERROR("Cannot open link trace " << filename);
+    }
+
+    LinkTrace &trace = linkTraces[key];
+    vector<uint32_t> opportunities;
+    uint64_t lastMs = 0;
+    string line;
+    while (getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos || line[line.find_first_not_of(" \t\r")] == '#') {
+            continue;
+        }
+        istringstream entry(line);
+        string first, rate, delay;
+        entry >> first >> rate >> delay;
+        if (rate.empty()) {
+            uint64_t ms = stoull(first);
+            uint32_t window = ms * 1000000 / step.GetNanoSeconds();
+            opportunities.resize(max<size_t>(opportunities.size(), window + 1), 0);
+            opportunities[window]++;
+            lastMs = max(lastMs, ms);
+            continue;
+        }
+        Time at = Seconds(stod(first));
+        uint64_t bitRate = DataRate(rate).GetBitRate();
+        Time stepDelay = delay.empty() ? MilliSeconds(-1) : Time(delay);
+        if (trace.rate.empty() || bitRate != trace.rate.back() || stepDelay != trace.delay.back()) {
+            trace.at.push_back(at);
+            trace.rate.push_back(bitRate);
+            trace.delay.push_back(stepDelay);
+        }
+    }
+
+    for (uint32_t window = 0; window < opportunities.size(); window++) {
+        // A window without any opportunity stalls the link, but a data rate must not be 0
+        uint64_t bitRate = max<uint64_t>(1000, opportunities[window] * 1500 * 8 / step.GetSeconds());
+        if (trace.rate.empty() || bitRate != trace.rate.back()) {
+            trace.at.push_back(step * window);
+            trace.rate.push_back(bitRate);
+            trace.delay.push_back(MilliSeconds(-1));
+        }
+    }
+    trace.period = opportunities.empty() ? Time(0) : max(MilliSeconds(lastMs), step * opportunities.size());
+
+    if (trace.at.empty()) {
+        NS_FATAL_ERROR("Empty link trace " << filename);
+    }
+    return &trace;
+}
+
+void ApplyLinkTraceStep(uint32_t index, uint32_t step) {
+    TracedLink &link = tracedLinks[index];
+    const LinkTrace &trace = *link.trace;
+    link.device[0]->SetDataRate(DataRate(trace.rate[step]));
+    link.device[1]->SetDataRate(DataRate(trace.rate[step]));
+    if (trace.delay[step] >= Time(0)) {
+        link.channel->SetAttribute("Delay", TimeValue(trace.delay[step]));
+    }
+
+    // Only the next change is scheduled, so a link costs one pending event whatever the trace length
+    if (step + 1 < trace.at.size()) {
+        Simulator::Schedule(trace.at[step + 1] - trace.at[step], &ApplyLinkTraceStep, index, step + 1);
+    } else if (trace.period > Time(0)) {
+        Simulator::Schedule(trace.period - trace.at[step] + trace.at[0], &ApplyLinkTraceStep, index, 0);
+    }
+}
+
+// Live metrics datagram: a header followed by count flow records, read by util/metrics_view.py
+typedef struct __attribute__((packed)) {
+    char magic[4]; // "NETP"
+    double time; // Simulation time in seconds
+    uint16_t count;
+    uint8_t last; // Last datagram of this sample
+} metrics_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t row;
+    uint8_t udp;
+    float throughput; // Kbps over the last period
+    float delay; // ms over the last period, UDP only
+    float interval; // us, UDP only
+    uint32_t lost; // UDP only
+} metrics_record_t;
+
+// Counters of a flow at the previous sample
+struct MetricsSample {
+    uint64_t rxBytes;
+    Time delaySum;
+    uint64_t received;
+};
+
+static int metricsSocket = -1;
+static sockaddr_un metricsAddress;
+static Time metricsPeriod;
+static map<uint32_t, MetricsSample> metricsSamples;
+
+void SendMetrics(vector<uint8_t> &datagram, bool last) {
+    metrics_header_t header;
+    memcpy(&header, &datagram[0], sizeof(header));
+    header.count = (datagram.size() - sizeof(header)) / sizeof(metrics_record_t);
+    header.last = last;
+    memcpy(&datagram[0], &header, sizeof(header));
+
+    // Never blocks the simulation, samples are dropped while no viewer is listening or it falls behind
+    sendto(metricsSocket, &datagram[0], datagram.size(), MSG_DONTWAIT, (sockaddr *) &metricsAddress, sizeof(metricsAddress));
+    datagram.resize(sizeof(header));
+}
+
+// Counters of a running flow, UDP delays only for UDP flows
+MetricsSample SampleFlow(const ActiveFlow &flow, bool udp) {
+    MetricsSample sample = {0, Time(0), 0};
+    if (udp) {
+        Ptr<UdpServer> server = StaticCast<UdpServer>(flow.server);
+        sample.rxBytes = server->GetTotalRx();
+        sample.received = server->GetReceived();
+        sample.delaySum = server->GetDelayAvg() * sample.received;
+    } else {
+        sample.rxBytes = GetTcpTotalRx(flow.server);
+    }
+    return sample;
+}
+
+void PublishMetrics(void) {
+    metrics_header_t header;
+    memcpy(header.magic, "NETP", 4);
+    header.time = Simulator::Now().GetSeconds();
+    vector<uint8_t> datagram((uint8_t *) &header, (uint8_t *) &header + sizeof(header));
+
+    map<uint32_t, MetricsSample> samples;
+    for (map<uint32_t, ActiveFlow>::iterator iter = activeFlows.begin(); iter != activeFlows.end(); iter++) {
+        uint32_t row = iter->first;
+        MetricsSample &sample = samples[row];
+        MetricsSample previous = {0, Time(0), 0};
+        map<uint32_t, MetricsSample>::iterator last = metricsSamples.find(row);
+        if (last != metricsSamples.end()) {
+            previous = last->second;
+        }
+
+        metrics_record_t record;
+        record.row = row;
+        record.udp = (flowTable.flags[row] & FLOW_UDP) != 0;
+        record.delay = 0;
+        record.interval = 0;
+        record.lost = 0;
+        sample = SampleFlow(iter->second, record.udp);
+        if (record.udp) {
+            Ptr<UdpServer> server = StaticCast<UdpServer>(iter->second.server);
+            Ptr<UdpClient> client = StaticCast<UdpClient>(iter->second.client);
+            if (sample.received > previous.received) {
+                record.delay = ((sample.delaySum - previous.delaySum) / (sample.received - previous.received)).GetMicroSeconds() / 1000.0;
+            }
+            if (client->GetPathCount() > 0) {
+                record.interval = client->GetController(0)->GetInterval().GetMicroSeconds();
+            }
+            record.lost = server->GetLost();
+        }
+        record.throughput = (sample.rxBytes - previous.rxBytes) * 8 / (metricsPeriod.GetSeconds() * 1000);
+
+        const uint8_t *bytes = (const uint8_t *) &record;
+        datagram.insert(datagram.end(), bytes, bytes + sizeof(record));
+        if (datagram.size() >= sizeof(header) + METRICS_BATCH * sizeof(record)) {
+            SendMetrics(datagram, false);
+        }
+    }
+    SendMetrics(datagram, true);
+    metricsSamples.swap(samples);
+
+    Simulator::Schedule(metricsPeriod, &PublishMetrics);
+}
+
+// Flight recorder dump: a header followed by count packet records, oldest first, read by util/flight.py
+#define FLIGHT_DUMP_END     0
+#define FLIGHT_DUMP_AT      1
+#define FLIGHT_DUMP_TRIGGER 2
+
+typedef struct __attribute__((packed)) {
+    char magic[4]; // "NFLT"
+    double time; // Simulation time of the dump in seconds
+    uint32_t row; // flow_file entry of the flow, its label in the report
+    uint8_t reason; // FLIGHT_DUMP_*
+    uint32_t count;
+} flight_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t hop; // Link index * 2 + side of the sending node, 0 for the src column of the topology
+    int64_t enqueue; // ns
+    int64_t dequeue; // ns, -1 if dropped or still queued
+} flight_hop_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t id; // Transmission index within the flow, retransmissions get their own
+    uint32_t seq;
+    uint16_t size;
+    uint8_t path;
+    uint8_t hops;
+    int64_t tx; // ns
+    int64_t rx; // ns, -1 if not received
+    flight_hop_t hop[FLIGHT_MAX_HOPS];
+} flight_record_t;
+
+// Identifies a recorded packet to the queue discs along its path
+class FlightTag : public Tag {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::FlightTag")
+            .SetParent<Tag>()
+            .AddConstructor<FlightTag>();
+        return tid;
+    }
+    virtual TypeId GetInstanceTypeId(void) const {
+        return GetTypeId();
+    }
+    virtual uint32_t GetSerializedSize(void) const {
+        return 8;
+    }
+    virtual void Serialize(TagBuffer i) const {
+        i.WriteU32(row);
+        i.WriteU32(id);
+    }
+    virtual void Deserialize(TagBuffer i) {
+        row = i.ReadU32();
+        id = i.ReadU32();
+    }
+    virtual void Print(std::ostream &os) const {
+        os << "row=" << row << " id=" << id;
+    }
+
+    uint32_t row;
+    uint32_t id;
+};
+
+// Last packets of a flow, indexed by id modulo the size
+struct FlightRing {
+    vector<flight_record_t> records;
+    uint32_t next; // Id of the next transmission
+    uint32_t armed; // Id from which a delay above flight_trigger dumps again
+};
+
+static uint32_t flightRecorderSize = 0; // Packets kept per static UDP flow, 0 to disable the recorder
+static Time flightTrigger; // Dump when a packet is delayed longer, 0 for no trigger
+static string flightFilename = "flight.bin";
+static ofstream flightFile;
+static map<uint32_t, FlightRing> flightRings;
+static uint32_t flightDumps = 0;
+
+flight_record_t *FindFlightRecord(const Packet &packet, FlightTag &tag) {
+    if (!packet.PeekPacketTag(tag)) {
+        return 0;
+    }
+    map<uint32_t, FlightRing>::iterator iter = flightRings.find(tag.row);
+    if (iter == flightRings.end()) {
+        return 0;
+    }
+    flight_record_t &record = iter->second.records[tag.id % flightRecorderSize];
+    return record.id == tag.id ? &record : 0;
+}
+
+void DumpFlight(uint32_t row, uint8_t reason) {
+    FlightRing &ring = flightRings[row];
+    if (!flightFile.is_open()) {
+        flightFile.open(flightFilename.c_str(), ios::binary | ios::trunc);
+    }
+
+    flight_header_t header;
+    memcpy(header.magic, "NFLT", 4);
+    header.time = Simulator::Now().GetSeconds();
+    header.row = flowTable.entry[row];
+    header.reason = reason;
+    header.count = min(ring.next, flightRecorderSize);
+    flightFile.write((const char *) &header, sizeof(header));
+    for (uint32_t id = ring.next - header.count; id != ring.next; id++) {
+        flightFile.write((const char *) &ring.records[id % flightRecorderSize], sizeof(flight_record_t));
+    }
+    flightFile.flush();
+    flightDumps++;
+}
+
+void DumpAllFlights(uint8_t reason) {
+    for (map<uint32_t, FlightRing>::iterator iter = flightRings.begin(); iter != flightRings.end(); iter++) {
+        DumpFlight(iter->first, reason);
+    }
+}
+
+void OnFlightTx(uint32_t row, Ptr<const Packet> packet) {
+    FlightRing &ring = flightRings[row];
+    FlightTag tag;
+    tag.row = row;
+    tag.id = ring.next++;
+    packet->AddPacketTag(tag);
+
+    UdpCcHeader header;
+    packet->PeekHeader(header);
+    flight_record_t &record = ring.records[tag.id % flightRecorderSize];
+    record.id = tag.id;
+    record.seq = header.GetSeq();
+    record.size = packet->GetSize();
+    record.path = header.GetPath();
+    record.hops = 0;
+    record.tx = Simulator::Now().GetNanoSeconds();
+    record.rx = -1;
+}
+
+void OnFlightRx(uint32_t row, Ptr<const Packet> packet) {
+    FlightTag tag;
+    flight_record_t *record = FindFlightRecord(*packet, tag);
+    if (record == 0) {
+        return;
+    }
+    record->rx = Simulator::Now().GetNanoSeconds();
+
+    // One dump per spike, the next needs a full ring of packets sent after it
+    FlightRing &ring = flightRings[row];
+    if (!flightTrigger.IsZero() && tag.id >= ring.armed && record->rx - record->tx > flightTrigger.GetNanoSeconds()) {
+        DumpFlight(row, FLIGHT_DUMP_TRIGGER);
+        ring.armed = ring.next + flightRecorderSize;
+    }
+}
+
+void OnFlightEnqueue(uint16_t hop, Ptr<const QueueDiscItem> item) {
+    FlightTag tag;
+    flight_record_t *record = FindFlightRecord(*item->GetPacket(), tag);
+    if (record == 0 || record->hops == FLIGHT_MAX_HOPS) {
+        return;
+    }
+    flight_hop_t &entry = record->hop[record->hops++];
+    entry.hop = hop;
+    entry.enqueue = Simulator::Now().GetNanoSeconds();
+    entry.dequeue = -1;
+}
+
+void OnFlightDequeue(uint16_t hop, Ptr<const QueueDiscItem> item) {
+    FlightTag tag;
+    flight_record_t *record = FindFlightRecord(*item->GetPacket(), tag);
+    if (record == 0) {
+        return;
+    }
+    for (uint32_t i = record->hops; i > 0; i--) {
+        if (record->hop[i - 1].hop == hop) {
+            record->hop[i - 1].dequeue = Simulator::Now().GetNanoSeconds();
+            return;
+        }
+    }
+}
+
+// Hooks the root queue discs of both directions of a link
+void InstallFlightHooks(uint32_t link, const NetDeviceContainer &devices) {
+    for (uint32_t side = 0; side < 2; side++) {
+        Ptr<NetDevice> device = devices.Get(side);
+        Ptr<QueueDisc> queueDisc = device->GetNode()->GetObject<TrafficControlLayer>()->GetRootQueueDiscOnDevice(device);
+        if (queueDisc != 0) {
+            queueDisc->TraceConnectWithoutContext("Enqueue", MakeBoundCallback(&OnFlightEnqueue, (uint16_t) (link * 2 + side)));
+            queueDisc->TraceConnectWithoutContext("Dequeue", MakeBoundCallback(&OnFlightDequeue, (uint16_t) (link * 2 + side)));
+        }
+    }
+}
+
+// Link trace sample: a header followed by a record for each direction of every link, read by util/links.py
+typedef struct __attribute__((packed)) {
+    char magic[4]; // "NLNK"
+    double time; // Simulation time in seconds
+    uint16_t count;
+} link_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t hop; // Link index * 2 + side of the sending node, as in the flight recorder
+    uint32_t queuePackets; // Root queue disc
+    uint32_t queueBytes;
+    uint32_t devicePackets; // Device queue
+    uint32_t drops; // Queue disc and device queue, since the previous sample
+    float sojourn; // Average queue disc sojourn time (ms) since the previous sample
+    float utilization; // Sent over capacity since the previous sample
+} link_record_t;
+
+// Queueing and load of one direction of a link
+struct LinkStats {
+    uint32_t node[2]; // Sending and receiving node
+    Ptr<QueueDisc> queueDisc;
+    Ptr<PointToPointNetDevice> device;
+    uint64_t sentBytes; // Passed to the device by the queue disc
+    uint64_t drops;
+    double capacity; // Bits the link could have sent
+    double periodCapacity;
+    Time sojournSum;
+    Time sojournMax;
+    uint64_t sojournCount;
+    Time periodSojournSum;
+    uint32_t periodSojournCount;
+    uint64_t queueSum; // Packets in both queues over the samples
+    uint32_t queueMax;
+    uint32_t samples;
+};
+
+static bool linkStatsEnabled = false;
+static Time linkSamplePeriod;
+static Time linkLastSample;
+static vector<LinkStats> linkStats; // Indexed by hop
+static ofstream linkTraceFile;
+
+void OnLinkSojourn(uint16_t hop, Time sojourn) {
+    LinkStats &stats = linkStats[hop];
+    stats.periodSojournSum += sojourn;
+    stats.periodSojournCount++;
+    stats.sojournMax = max(stats.sojournMax, sojourn);
+}
+
+// Hooks both directions of a link, queue lengths and counters are read by SampleLinks
+void InstallLinkStats(uint32_t link, const NetDeviceContainer &devices, uint32_t src, uint32_t dst) {
+    if (linkStats.size() < (link + 1) * 2) {
+        linkStats.resize((link + 1) * 2);
+    }
+    for (uint32_t side = 0; side < 2; side++) {
+        LinkStats &stats = linkStats[link * 2 + side];
+        stats.node[0] = side == 0 ? src : dst;
+        stats.node[1] = side == 0 ? dst : src;
+        stats.device = DynamicCast<PointToPointNetDevice>(devices.Get(side));
+        stats.queueDisc = stats.device->GetNode()->GetObject<TrafficControlLayer>()->GetRootQueueDiscOnDevice(stats.device);
+        stats.sentBytes = stats.drops = 0;
+        stats.capacity = stats.periodCapacity = 0;
+        stats.sojournSum = stats.sojournMax = stats.periodSojournSum = Time(0);
+        stats.sojournCount = stats.periodSojournCount = 0;
+        stats.queueSum = stats.queueMax = stats.samples = 0;
+        if (stats.queueDisc != 0) {
+            stats.queueDisc->TraceConnectWithoutContext("SojournTime", MakeBoundCallback(&OnLinkSojourn, (uint16_t) (link * 2 + side)));
+        }
+    }
+}
+
+void SampleLinks(void) {
+    Time now = Simulator::Now();
+    double elapsed = (now - linkLastSample).GetSeconds();
+    linkLastSample = now;
+
+    link_header_t header;
+    memcpy(header.magic, "NLNK", 4);
+    header.time = now.GetSeconds();
+    header.count = linkStats.size();
+    if (linkTraceFile.is_open()) {
+        linkTraceFile.write((const char *) &header, sizeof(header));
+    }
+
+    for (uint32_t hop = 0; hop < linkStats.size(); hop++) {
+        LinkStats &stats = linkStats[hop];
+        link_record_t record;
+        record.hop = hop;
+        record.queuePackets = record.queueBytes = 0;
+        uint64_t sentBytes = 0, drops = 0;
+        if (stats.queueDisc != 0) {
+            const QueueDisc::Stats &queueStats = stats.queueDisc->GetStats();
+            record.queuePackets = stats.queueDisc->GetNPackets();
+            record.queueBytes = stats.queueDisc->GetNBytes();
+            sentBytes = queueStats.nTotalSentBytes;
+            drops = queueStats.nTotalDroppedPackets;
+        }
+        Ptr<Queue<Packet> > deviceQueue = stats.device->GetQueue();
+        record.devicePackets = deviceQueue->GetNPackets();
+        drops += deviceQueue->GetTotalDroppedPackets();
+
+        // Link traces change the rate, so the capacity is summed per sample
+        DataRateValue rate;
+        stats.device->GetAttribute("DataRate", rate);
+        double capacity = rate.Get().GetBitRate() * elapsed;
+        record.drops = drops - stats.drops;
+        record.utilization = capacity > 0 ? (sentBytes - stats.sentBytes) * 8 / capacity : 0;
+        record.sojourn = stats.periodSojournCount > 0 ?
+                         (stats.periodSojournSum / stats.periodSojournCount).GetMicroSeconds() / 1000.0 : 0;
+
+        stats.sentBytes = sentBytes;
+        stats.drops = drops;
+        stats.capacity += capacity;
+        stats.sojournSum += stats.periodSojournSum;
+        stats.sojournCount += stats.periodSojournCount;
+        stats.periodSojournSum = Time(0);
+        stats.periodSojournCount = 0;
+        stats.queueSum += record.queuePackets + record.devicePackets;
+        stats.queueMax = max(stats.queueMax, record.queuePackets + record.devicePackets);
+        stats.samples++;
+
+        if (linkTraceFile.is_open()) {
+            linkTraceFile.write((const char *) &record, sizeof(record));
+        }
+    }
+}
+
+void ScheduleLinkSample(void) {
+    SampleLinks();
+    Simulator::Schedule(linkSamplePeriod, &ScheduleLinkSample);
+}
+
+bool CompareLinkUtilization(uint32_t a, uint32_t b) {
+    return linkStats[a].sentBytes * 8 / max(linkStats[a].capacity, 1.0) > linkStats[b].sentBytes * 8 / max(linkStats[b].capacity, 1.0);
+}
+
+// Queueing of every link that carried traffic, then the bottleneck links by utilization
+void PrintLinkStats(void) {
+    SampleLinks(); // The rest of the last period
+    vector<uint32_t> busy;
+    for (uint32_t hop = 0; hop < linkStats.size(); hop++) {
+        const LinkStats &stats = linkStats[hop];
+        if (stats.sentBytes == 0) {
+            continue;
+        }
+        busy.push_back(hop);
+        NS_LOG_UNCOND("(LINK) " << stats.node[0] << " -> " << stats.node[1] << ": Utilization " <<
+                      stats.sentBytes * 8 / max(stats.capacity, 1.0) * 100 << " %" <<
+                      " Queue avg " << (double) stats.queueSum / max<uint32_t>(stats.samples, 1) << " max " << stats.queueMax << " packets" <<
+                      " Sojourn avg " << (stats.sojournCount > 0 ? (stats.sojournSum / stats.sojournCount).GetMicroSeconds() / 1000.0 : 0) <<
+                      " max " << stats.sojournMax.GetMicroSeconds() / 1000.0 << " ms" <<
+                      " Drops " << stats.drops);
+    }
+
+    // The busiest link is the bottleneck even when no link is saturated
+    sort(busy.begin(), busy.end(), CompareLinkUtilization);
+    for (uint32_t i = 0; i < busy.size(); i++) {
+        const LinkStats &stats = linkStats[busy[i]];
+        double utilization = stats.sentBytes * 8 / max(stats.capacity, 1.0);
+        if (i > 0 && utilization < LINK_BOTTLENECK_UTILIZATION) {
+            break;
+        }
+        NS_LOG_UNCOND("(LINK) Bottleneck " << stats.node[0] << " -> " << stats.node[1] << ": Utilization " << utilization * 100 << " %" <<
+                      " Sojourn avg " << (stats.sojournCount > 0 ? (stats.sojournSum / stats.sojournCount).GetMicroSeconds() / 1000.0 : 0) << " ms" <<
+                      " Drops " << stats.drops);
+    }
+}
+
+// Throughput and delay of a running flow over the last converge_window
+struct ConvergenceState {
+    MetricsSample last;
+    Time lastRx; // Last time the flow received anything
+    deque<double> throughput; // Kbps per period
+    deque<double> delay; // ms per period with receptions, UDP only
+};
+
+static bool autoStop = false; // Stop once every flow is finished or idle
+static uint32_t convergeWindow = 0; // s of steady throughput and delay before stopping, 0 to never stop on convergence
+static double convergeBand = 0.05; // Largest relative standard deviation of a steady flow
+static map<uint32_t, ConvergenceState> convergenceStates;
+static string stopReason;
+
+// Standard deviation over the mean, 0 for no samples
+double RelativeDeviation(const deque<double> &samples) {
+    double sum = 0, squareSum = 0;
+    for (deque<double>::const_iterator iter = samples.begin(); iter != samples.end(); iter++) {
+        sum += *iter;
+        squareSum += *iter * *iter;
+    }
+    if (samples.empty() || sum <= 0) {
+        return 0;
+    }
+    double mean = sum / samples.size();
+    return sqrt(max(0.0, squareSum / samples.size() - mean * mean)) / mean;
+}
+
+// Flows of flow_file not started yet, or generators still creating flows
+bool HasPendingFlows(void) {
+    for (uint32_t row = 0; row < flowTable.GetSize(); row++) {
+        if (!(flowTable.flags[row] & (FLOW_GENERATED | FLOW_STARTED))) {
+            return true;
+        }
+    }
+    for (list<FlowGenerator>::iterator iter = flowGenerators.begin(); iter != flowGenerators.end(); iter++) {
+        if (Simulator::Now() < iter->stopTime) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CheckAutoStop(void) {
+    Time period = MilliSeconds(AUTO_STOP_PERIOD);
+    uint32_t windowSamples = convergeWindow * 1000 / AUTO_STOP_PERIOD;
+    bool idle = true;
+    bool converged = windowSamples > 0;
+    uint32_t steadyFlows = 0;
+
+    map<uint32_t, ConvergenceState> states;
+    for (map<uint32_t, ActiveFlow>::iterator iter = activeFlows.begin(); iter != activeFlows.end(); iter++) {
+        uint32_t row = iter->first;
+        bool udp = (flowTable.flags[row] & FLOW_UDP) != 0;
+        MetricsSample sample = SampleFlow(iter->second, udp);
+        ConvergenceState &state = states[row];
+        map<uint32_t, ConvergenceState>::iterator previous = convergenceStates.find(row);
+        if (previous == convergenceStates.end()) {
+            // First check of the flow
+            state.last = sample;
+            state.lastRx = Simulator::Now();
+            idle = converged = false;
+            continue;
+        }
+        state = previous->second;
+
+        if (sample.rxBytes > state.last.rxBytes) {
+            state.lastRx = Simulator::Now();
+        }
+        state.throughput.push_back((sample.rxBytes - state.last.rxBytes) * 8 / (period.GetSeconds() * 1000));
+        if (udp && sample.received > state.last.received) {
+            state.delay.push_back(((sample.delaySum - state.last.delaySum) / (sample.received - state.last.received)).GetMicroSeconds() / 1000.0);
+        }
+        while (state.throughput.size() > windowSamples) {
+            state.throughput.pop_front();
+        }
+        while (state.delay.size() > windowSamples) {
+            state.delay.pop_front();
+        }
+        state.last = sample;
+
+        idle = idle && Simulator::Now() - state.lastRx >= MilliSeconds(flowIdleTimeout);
+        // Generated flows are too short to settle, only the flows of flow_file have to
+        if (!(flowTable.flags[row] & FLOW_GENERATED)) {
+            converged = converged && state.throughput.size() >= windowSamples &&
+                        RelativeDeviation(state.throughput) <= convergeBand && RelativeDeviation(state.delay) <= convergeBand;
+            steadyFlows++;
+        }
+    }
+    convergenceStates.swap(states);
+
+    if (!HasPendingFlows()) {
+        if (autoStop && idle) {
+            stopReason = "All flows finished or idle";
+        } else if (converged && steadyFlows > 0) {
+            stopReason = "Throughput and delay of every flow steady for " + to_string(convergeWindow) + " s";
+        }
+    }
+    if (!stopReason.empty()) {
+        Simulator::Stop();
+        return;
+    }
+    Simulator::Schedule(period, &CheckAutoStop);
+}
+
+// Shortest path from src to dst in links, avoiding the excluded links
+vector<uint32_t> FindPath(uint32_t src, uint32_t dst, const vector<bool> &excluded) {
+    vector<int32_t> viaLink(nodeLinks.size(), -1);
+    vector<bool> visited(nodeLinks.size(), false);
+    list<uint32_t> queue;
+    queue.push_back(src);
+    visited[src] = true;
+
+    while (!queue.empty() && !visited[dst]) {
+        uint32_t node = queue.front();
+        queue.pop_front();
+        for (vector<uint32_t>::iterator iter = nodeLinks[node].begin(); iter != nodeLinks[node].end(); iter++) {
+            const TopologyLink &link = topologyLinks[*iter];
+            uint32_t neighbor = link.node[0] == node ? link.node[1] : link.node[0];
+            if (!excluded[*iter] && !visited[neighbor]) {
+                visited[neighbor] = true;
+                viaLink[neighbor] = *iter;
+                queue.push_back(neighbor);
+            }
+        }
+    }
+
+    vector<uint32_t> path;
+    for (uint32_t node = dst; visited[dst] && node != src; ) {
+        const TopologyLink &link = topologyLinks[viaLink[node]];
+        path.insert(path.begin(), viaLink[node]);
+        node = link.node[0] == node ? link.node[1] : link.node[0];
+    }
+    return path;
+}
+
+// Give dst one extra address per link-disjoint path from src and route each address along its path
+vector<Ipv4Address> SetupPaths(uint32_t src, uint32_t dst, uint32_t count) {
+    vector<Ipv4Address> addresses;
+    vector<bool> excluded(topologyLinks.size(), false);
+    Ipv4StaticRoutingHelper staticRouting;
+
+    for (uint32_t i = 0; i < count; i++) {
+        vector<uint32_t> path = FindPath(src, dst, excluded);
+        if (path.empty()) {
+            break;
+        }
+
+        Ipv4Address pathAddress(Ipv4Address("172.16.0.0").Get() + nextPathAddress++);
+        uint32_t node = src;
+        for (vector<uint32_t>::iterator iter = path.begin(); iter != path.end(); iter++) {
+            const TopologyLink &link = topologyLinks[*iter];
+            uint32_t side = link.node[0] == node ? 0 : 1;
+            Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting(flowNodes[node]->GetObject<Ipv4>());
+            routing->AddHostRouteTo(pathAddress, link.address[1 - side], link.ifIndex[side]);
+            node = link.node[1 - side];
+
+            // Access links of the hosts are shared by all paths
+            if (*iter != path.front() && *iter != path.back()) {
+                excluded[*iter] = true;
+            }
+        }
+
+        const TopologyLink &lastLink = topologyLinks[path.back()];
+        uint32_t dstSide = lastLink.node[0] == dst ? 0 : 1;
+        flowNodes[dst]->GetObject<Ipv4>()->AddAddress(lastLink.ifIndex[dstSide],
+                                                        Ipv4InterfaceAddress(pathAddress, Ipv4Mask("255.255.255.255")));
+        addresses.push_back(pathAddress);
+
+        // Without a core link on the path there is no alternative
+        if (path.size() <= 2) {
+            break;
+        }
+    }
+    return addresses;
+}
+
+void StartDynamicFlow(FlowGenerator *generator);
+
+// Link of topo_file with its optional columns
+struct LinkSpec {
+    uint32_t src;
+    uint32_t dst;
+    string bandwidth;
+    string delay;
+    string traceFilename;
+    Time traceStep;
+    string queueDisc;
+    string queueLimit;
+    string deviceQueueLimit;
+    vector< pair<string, string> > queueDiscAttributes;
+    double errorRate[2]; // Packet loss rate towards dst and towards src
+    Time errorStart; // The loss applies from errorStart until errorStop, 0 for the whole run
+    Time errorStop;
+};
+
+// Links with the same key share a queue disc configuration
+string QueueDiscKey(const LinkSpec &link) {
+    string key = link.queueDisc + " " + link.queueLimit;
+    for (vector< pair<string, string> >::const_iterator iter = link.queueDiscAttributes.begin(); iter != link.queueDiscAttributes.end(); iter++) {
+        key += " " + iter->first + "=" + iter->second;
+    }
+    return key;
+}
+
+void SetRootQueueDisc(TrafficControlHelper &tch, const LinkSpec &link, bool ecn, bool ecnScalable) {
+    QueueSizeValue maxSize = QueueSizeValue(QueueSize(link.queueLimit)); // Packets ("50p") or bytes ("75000B")
+    if (link.queueDisc == "CoDel") {
+        // CoDel queue disc, marks ECT packets instead of dropping them when ECN is enabled
+        tch.SetRootQueueDisc("ns3::CoDelQueueDisc", "MaxSize", maxSize,
+                             "UseEcn", BooleanValue(ecn || ecnScalable));
+    } else if (link.queueDisc == "FqCoDel") {
+        // CoDel per flow queue, isolates the UDP flows from the TCP flows sharing the link
+        tch.SetRootQueueDisc("ns3::FqCoDelQueueDisc", "MaxSize", maxSize,
+                             "UseEcn", BooleanValue(ecn || ecnScalable));
+    } else if (link.queueDisc == "Pie") {
+        // PIE queue disc
+        tch.SetRootQueueDisc("ns3::PieQueueDisc", "MaxSize", maxSize);
+    } else if (link.queueDisc == "Red" && ecnScalable) {
+        // RED as a step marker for the scalable response (DCTCP/L4S-style): the instantaneous queue (QW 1)
+        // marks every packet from 6 packets on, as without Gentle everything above MaxTh is marked
+        tch.SetRootQueueDisc("ns3::RedQueueDisc", "MaxSize", maxSize,
+                             "UseEcn", BooleanValue(true), "UseHardDrop", BooleanValue(false), "Gentle", BooleanValue(false),
+                             "QW", DoubleValue(1.0), "MinTh", DoubleValue(5), "MaxTh", DoubleValue(6));
+    } else if (link.queueDisc == "Red") {
+        // RED queue disc
+        tch.SetRootQueueDisc("ns3::RedQueueDisc", "MaxSize", maxSize,
+                             "UseEcn", BooleanValue(ecn));
+    } else if (link.queueDisc == "PfifoFast") {
+        tch.SetRootQueueDisc("ns3::PfifoFastQueueDisc", "MaxSize", maxSize); // ns3 default queue disc
+    } else {
+        NS_FATAL_ERROR("Unknown queue disc " << link.queueDisc);
+    }
+}
+
+// Random packet loss on the receiving devices of a link, e.g. to cut the return path of the UDP feedback
+void InstallLinkErrors(const LinkSpec &spec, const NetDeviceContainer &devices) {
+    for (uint32_t direction = 0; direction < 2; direction++) {
+        if (spec.errorRate[direction] <= 0) {
+            continue;
+        }
+        Ptr<RateErrorModel> errorModel = CreateObject<RateErrorModel>();
+        errorModel->SetAttribute("ErrorRate", DoubleValue(spec.errorRate[direction]));
+        errorModel->SetAttribute("ErrorUnit", EnumValue(RateErrorModel::ERROR_UNIT_PACKET));
+        if (spec.errorStart > Time(0)) {
+            errorModel->Disable();
+            Simulator::Schedule(spec.errorStart, &ErrorModel::Enable, errorModel);
+        }
+        if (spec.errorStop > Time(0)) {
+            Simulator::Schedule(spec.errorStop, &ErrorModel::Disable, errorModel);
+        }
+        devices.Get(direction == 0 ? 1 : 0)->SetAttribute("ReceiveErrorModel", PointerValue(errorModel));
+    }
+}
+
+// Wall-clock time of a setup phase, the clock restarts for the next phase
+void LogSetupPhase(SystemWallClockMs &clock, const char *phase) {
+    NS_LOG_UNCOND("(SETUP) " << phase << ": " << clock.End() << " ms");
+    clock.Start();
+}
+
+// Resident set size and its peak in kB, 0 when /proc is not available
+void ReadResidentMemory(uint64_t &rss, uint64_t &peak) {
+    rss = peak = 0;
+    ifstream status("/proc/self/status");
+    string key;
+    uint64_t value;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> value) {
+            rss = value;
+        } else if (key == "VmHWM:" && status >> value) {
+            peak = value;
+        }
+    }
+}
+
+Ptr<Application> CreateApplication(ObjectFactory &factory, Ptr<Node> node) {
+    // Not added to the node, so dropping the last reference really frees the application
+    Ptr<Application> app = factory.Create<Application>();
+    app->SetNode(node);
+    Simulator::ScheduleWithContext(node->GetId(), Seconds(0), &Application::Initialize, app);
+    return app;
+}
+
+void SetTcpSocketType(Ptr<Node> node, TypeId socketType) {
+    node->GetObject<TcpL4Protocol>()->SetAttribute("SocketType", TypeIdValue(socketType));
+}
+
+void InitializeTcpClient(Ptr<Application> app, TypeId socketType) {
+    // BulkSend and OnOff create their socket in StartApplication with the SocketType of the node's TcpL4Protocol.
+    // Initialize schedules StartApplication now (start time 0), so it runs right between the events that set
+    // the congestion control of the flow and restore the previous one, and flows of other variants keep theirs.
+    Ptr<Node> node = app->GetNode();
+    TypeIdValue previous;
+    node->GetObject<TcpL4Protocol>()->GetAttribute("SocketType", previous);
+    Simulator::ScheduleNow(&SetTcpSocketType, node, socketType);
+    app->Initialize();
+    Simulator::ScheduleNow(&SetTcpSocketType, node, previous.Get());
+}
+
+// Like CreateApplication, for a TCP client whose socket uses the given congestion control
+Ptr<Application> CreateTcpClient(ObjectFactory &factory, Ptr<Node> node, TypeId socketType) {
+    Ptr<Application> app = factory.Create<Application>();
+    app->SetNode(node);
+    Simulator::ScheduleWithContext(node->GetId(), Seconds(0), &InitializeTcpClient, app, socketType);
+    return app;
+}
+
+void TearDownApplication(Ptr<Application> app) {
+    Ptr<PacketSink> sink = DynamicCast<PacketSink>(app);
+    if (sink != 0) {
+        list< Ptr<Socket> > sockets = sink->GetAcceptedSockets();
+        if (sink->GetListeningSocket() != 0) {
+            sockets.push_back(sink->GetListeningSocket());
+        }
+        for (list< Ptr<Socket> >::iterator iter = sockets.begin(); iter != sockets.end(); iter++) {
+            (*iter)->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            (*iter)->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+            (*iter)->Close();
+        }
+    }
+
+    Ptr<BulkSendApplication> bulk = DynamicCast<BulkSendApplication>(app);
+    if (bulk != 0 && bulk->GetSocket() != 0) {
+        bulk->GetSocket()->SetConnectCallback(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+        bulk->GetSocket()->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+        bulk->GetSocket()->Close();
+    }
+
+    Ptr<OnOffApplication> onOff = DynamicCast<OnOffApplication>(app);
+    if (onOff != 0 && onOff->GetSocket() != 0) {
+        onOff->GetSocket()->SetConnectCallback(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+        onOff->GetSocket()->Close();
+    }
+
+    app->Dispose();
+}
+
+// Copy the details of the report of a UDP flow out of its applications
+void HarvestUdpReport(uint32_t row, const ActiveFlow &flow) {
+    Ptr<UdpServer> server = StaticCast<UdpServer>(flow.server);
+    Ptr<UdpClient> client = StaticCast<UdpClient>(flow.client);
+    UdpFlowReport &report = flowTable.udpReports[row];
+    report.feedbackDelay = client->GetFeedbackDelay().GetTimeStep();
+    report.intervalDeviation = client->GetIntervalDeviation().GetTimeStep();
+    report.capBlocked = client->GetCapBlocked();
+    report.feedbackTimeouts = client->GetFeedbackTimeouts();
+    report.averagePacketSize = client->GetAveragePacketSize();
+    for (uint8_t reason = 0; reason < UdpCcController::DECISION_REASONS; reason++) {
+        report.decisionCount[reason] = 0;
+        report.decisionDelta[reason] = 0;
+        for (uint32_t path = 0; path < client->GetPathCount(); path++) {
+            report.decisionCount[reason] += client->GetController(path)->GetDecisionCount(reason);
+            report.decisionDelta[reason] += client->GetController(path)->GetDecisionDelta(reason).GetTimeStep();
+        }
+    }
+    report.frames = client->GetFrames();
+    report.framesOnTime = server->GetFramesOnTime();
+    report.framesLate = server->GetFramesLate();
+    report.skippedFrames = client->GetSkippedFrames();
+    report.frameLatency[0] = server->GetFrameLatency(50).GetTimeStep();
+    report.frameLatency[1] = server->GetFrameLatency(95).GetTimeStep();
+    report.frameLatency[2] = server->GetFrameLatency(99).GetTimeStep();
+    report.stalls = server->GetStalls();
+    report.stallTime = server->GetStallTime().GetTimeStep();
+    report.paths.clear();
+    if (server->GetPathCount() > 1) {
+        for (uint32_t path = 0; path < server->GetPathCount(); path++) {
+            PathReport pathReport;
+            pathReport.rxBytes = server->GetPathTotalRx(path);
+            pathReport.delay = server->GetPathDelayAvg(path).GetTimeStep();
+            pathReport.lost = server->GetPathLost(path);
+            report.paths.push_back(pathReport);
+        }
+    }
+}
+
+// Copy the results of a flow out of its server application into the flow table
+void HarvestFlow(uint32_t row, const ActiveFlow &flow) {
+    if (flowTable.flags[row] & FLOW_UDP) {
+        Ptr<UdpServer> server = StaticCast<UdpServer>(flow.server);
+        flowTable.rxBytes[row] = server->GetTotalRx();
+        flowTable.lost[row] = server->GetLost();
+        flowTable.rxPackets[row] = server->GetReceived();
+        if (server->GetReceived() > 0) {
+            flowTable.delay[row] = server->GetDelayAvg().GetTimeStep();
+            flowTable.delayP99[row] = server->GetDelayPercentile(99).GetTimeStep();
+        }
+        if (reliableUdp) {
+            // Completion is the delivery of the last missing packet, not the last (duplicate) reception
+            flowTable.delivered[row] = server->GetDelivered();
+            flowTable.retransmitted[row] = StaticCast<UdpClient>(flow.client)->GetRetransmissions();
+            if (server->GetDelivered() > 0) {
+                flowTable.lastRx[row] = server->GetLastDelivery().GetTimeStep();
+            }
+        }
+        if (!(flowTable.flags[row] & FLOW_GENERATED)) {
+            HarvestUdpReport(row, flow);
+        }
+    } else {
+        flowTable.rxBytes[row] = GetTcpTotalRx(flow.server);
+    }
+}
+
+void FinishFlow(uint32_t row, bool timedOut) {
+    map<uint32_t, ActiveFlow>::iterator iter = activeFlows.find(row);
+    if (iter == activeFlows.end()) {
+        return;
+    }
+    FlowGenerator *generator = iter->second.generator;
+
+    HarvestFlow(row, iter->second);
+    flowTable.flags[row] |= FLOW_FINISHED | (timedOut ? FLOW_TIMED_OUT : 0);
+
+    TearDownApplication(iter->second.client);
+    TearDownApplication(iter->second.server);
+    activeFlows.erase(iter);
+
+    if (generator != 0) {
+        generator->activePorts.erase(flowTable.port[row]);
+
+        // On/off source: next on period begins after an off period
+        if (!generator->poisson) {
+            Time offTime = Seconds(generator->gap->GetValue());
+            if (Simulator::Now() + offTime < generator->stopTime) {
+                Simulator::Schedule(offTime, &StartDynamicFlow, generator);
+            }
+        }
+    }
+}
+
+void OnDynamicUdpRx(uint32_t row, Ptr<const Packet> packet) {
+    map<uint32_t, ActiveFlow>::iterator iter = activeFlows.find(row);
+    if (iter == activeFlows.end() || iter->second.finishing) {
+        return;
+    }
+    flowTable.lastRx[row] = Simulator::Now().GetTimeStep();
+    flowTable.rxBytes[row] += packet->GetSize();
+
+    // Reliable flows finish when the client has every packet acknowledged, and flows with
+    // adaptive packet size when all their bytes have arrived
+    UdpCcHeader header;
+    packet->PeekHeader(header);
+    bool last = adaptivePacketSize ? flowTable.rxBytes[row] >= (uint64_t) flowTable.packets[row] * 1000 :
+                                     header.GetSeq() + 1 >= flowTable.packets[row];
+    if (!reliableUdp && last) {
+        // Last packet arrived, tear down outside of the server's receive loop
+        iter->second.finishing = true;
+        Simulator::ScheduleNow(&FinishFlow, row, false);
+    }
+}
+
+void OnUdpComplete(uint32_t row, uint32_t retransmissions) {
+    map<uint32_t, ActiveFlow>::iterator iter = activeFlows.find(row);
+    if (iter == activeFlows.end() || iter->second.finishing) {
+        return;
+    }
+    iter->second.finishing = true;
+    Simulator::ScheduleNow(&FinishFlow, row, false);
+}
+
+void OnTcpRx(uint32_t row, Ptr<const Packet> packet, const Address &from) {
+    map<uint32_t, ActiveFlow>::iterator iter = activeFlows.find(row);
+    if (iter == activeFlows.end() || iter->second.finishing) {
+        return;
+    }
+    flowTable.lastRx[row] = Simulator::Now().GetTimeStep();
+    flowTable.rxBytes[row] += packet->GetSize();
+
+    if (flowTable.rxBytes[row] >= (uint64_t) flowTable.packets[row] * 1000) {
+        iter->second.finishing = true;
+        Simulator::ScheduleNow(&FinishFlow, row, false);
+    }
+}
+
+void CheckDynamicFlowIdle(uint32_t row) {
+    map<uint32_t, ActiveFlow>::iterator iter = activeFlows.find(row);
+    if (iter == activeFlows.end() || iter->second.finishing) {
+        return;
+    }
+
+    // UDP tail packets may be lost, so the flow ends once the receiver has been idle long enough.
+    // A flow with nothing delivered ends once its client has sent everything and been idle as long.
+    Time idle = Simulator::Now() - TimeStep(flowTable.lastRx[row]);
+    if (flowTable.rxBytes[row] == 0) {
+        Ptr<UdpClient> client = StaticCast<UdpClient>(iter->second.client);
+        idle = client->HasMoreData() ? Time(0) : Simulator::Now() - client->GetLastTx();
+    }
+    if (idle >= MilliSeconds(flowIdleTimeout)) {
+        iter->second.finishing = true;
+        FinishFlow(row, true);
+    } else {
+        Simulator::Schedule(MilliSeconds(flowIdleTimeout), &CheckDynamicFlowIdle, row);
+    }
+}
+
+void StartFlow(uint32_t row, FlowGenerator *generator) {
+    Ptr<Node> srcNode = flowNodes[flowTable.src[row]];
+    Ptr<Node> dstNode = flowNodes[flowTable.dst[row]];
+    Ipv4Address dstAddress = flowAddresses[flowTable.dst[row]];
+    uint16_t port = flowTable.port[row];
+
+    ActiveFlow &flow = activeFlows[row];
+    flow.generator = generator;
+    flow.finishing = false;
+    flowTable.flags[row] |= FLOW_STARTED;
+    flowTable.start[row] = Simulator::Now().GetTimeStep();
+    flowTable.lastRx[row] = Simulator::Now().GetTimeStep();
+    peakActiveFlows = max<uint32_t>(peakActiveFlows, activeFlows.size());
+
+    ObjectFactory serverFactory, clientFactory;
+    if (flowTable.flags[row] & FLOW_UDP) {
+        // You can add/remove/change parameters of UDP
+        serverFactory.SetTypeId(UdpServer::GetTypeId());
+        serverFactory.Set("Port", UintegerValue(port));
+        flow.server = CreateApplication(serverFactory, dstNode);
+
+        clientFactory.SetTypeId(UdpClient::GetTypeId());
+        clientFactory.Set("RemoteAddress", AddressValue(dstAddress));
+        clientFactory.Set("RemotePort", UintegerValue(port));
+        clientFactory.Set("MaxPackets", UintegerValue(flowTable.packets[row]));
+        // clientFactory.Set("Interval", TimeValue(MilliSeconds(1))); // Managed by application-level congestion controller
+        clientFactory.Set("PacketSize", UintegerValue(1000)); // Do not modify
+        if (stateCache != 0) {
+            clientFactory.Set("StateCache", PointerValue(stateCache));
+        }
+        flow.client = CreateApplication(clientFactory, srcNode);
+
+        if (generator == 0 && multipathCount > 1) {
+            vector<Ipv4Address> pathAddresses = SetupPaths(flowTable.src[row], flowTable.dst[row], multipathCount);
+            for (vector<Ipv4Address>::iterator iter = pathAddresses.begin(); iter != pathAddresses.end(); iter++) {
+                StaticCast<UdpClient>(flow.client)->AddPath(*iter);
+            }
+        }
+
+        if (reliableUdp) {
+            flow.client->TraceConnectWithoutContext("Complete", MakeBoundCallback(&OnUdpComplete, row));
+        }
+
+        if (generator != 0) {
+            flow.server->TraceConnectWithoutContext("Rx", MakeBoundCallback(&OnDynamicUdpRx, row));
+            Simulator::Schedule(MilliSeconds(flowIdleTimeout), &CheckDynamicFlowIdle, row);
+            return;
+        }
+
+        // Set up Udp Troughput Trace
+        // Simulator::Schedule(MilliSeconds(LOG_INTERVAL), &LogUdpThroughput, flowTable.entry[row], StaticCast<UdpServer>(flow.server), 0);
+
+        // Set up Udp Delay Trace
+        // flow.server->TraceConnect("Delay", to_string(flowTable.entry[row]), MakeCallback(&LogUdpDelay));
+
+        // Set up Udp Trendline Slope Trace
+        // flow.client->TraceConnect("TrendlineSlope", to_string(flowTable.entry[row]), MakeCallback(&LogUdpTrendline));
+        // flow.client->TraceConnect("Interval", to_string(flowTable.entry[row]), MakeCallback(&LogUdpInterval));
+        // flow.client->TraceConnect("Lost", to_string(flowTable.entry[row]), MakeCallback(&LogUdpLost));
+        // flow.client->TraceConnect("TargetInterval", to_string(flowTable.entry[row]), MakeCallback(&LogUdpTargetInterval));
+        // flow.client->TraceConnect("Ce", to_string(flowTable.entry[row]), MakeCallback(&LogUdpCe));
+
+        // Set up Udp Flight Recorder
+        if (flightRecorderSize > 0) {
+            FlightRing &ring = flightRings[row];
+            ring.records.resize(flightRecorderSize);
+            ring.next = 0;
+            ring.armed = 0;
+            flow.client->TraceConnectWithoutContext("Tx", MakeBoundCallback(&OnFlightTx, row));
+            flow.server->TraceConnectWithoutContext("Rx", MakeBoundCallback(&OnFlightRx, row));
+        }
+
+        // Set up Udp Rate Decision Trace
+        if (decisionLog > 0) {
+            flow.client->TraceConnect("Decision", to_string(flowTable.entry[row]), MakeCallback(&LogUdpDecision));
+        }
+    } else {
+        // Do not modify parameters of TCP
+        const TrafficProfile &profile = trafficProfiles[flowTable.profile[row]];
+        if (profile.kind == PROFILE_REQRESP) {
+            // The receiver of the flow requests the responses, which the sender serves on the flow's port
+            serverFactory.SetTypeId(TcpReqRespClient::GetTypeId());
+            serverFactory.Set("Remote", AddressValue(InetSocketAddress(flowAddresses[flowTable.src[row]], port)));
+            serverFactory.Set("RequestSize", UintegerValue(profile.requestSize));
+            serverFactory.Set("ResponseSize", UintegerValue(profile.responseSize));
+            serverFactory.Set("ThinkTime", StringValue("ns3::ExponentialRandomVariable[Mean=" + to_string(profile.thinkTime) + "]"));
+            serverFactory.Set("MaxBytes", UintegerValue((uint64_t) flowTable.packets[row] * 1000));
+            flow.server = CreateApplication(serverFactory, dstNode);
+
+            clientFactory.SetTypeId(TcpReqRespServer::GetTypeId());
+            clientFactory.Set("Port", UintegerValue(port));
+            clientFactory.Set("RequestSize", UintegerValue(profile.requestSize));
+            clientFactory.Set("ResponseSize", UintegerValue(profile.responseSize));
+            flow.client = CreateApplication(clientFactory, srcNode);
+            StaticCast<TcpReqRespServer>(flow.client)->SetCongestionControl(profile.tcpVariant);
+        } else {
+            serverFactory.SetTypeId(PacketSink::GetTypeId());
+            serverFactory.Set("Local", AddressValue(InetSocketAddress(Ipv4Address::GetAny(), port)));
+            serverFactory.Set("Protocol", TypeIdValue(TcpSocketFactory::GetTypeId()));
+            flow.server = CreateApplication(serverFactory, dstNode);
+
+            if (profile.kind == PROFILE_ONOFF) {
+                clientFactory.SetTypeId(OnOffApplication::GetTypeId());
+                clientFactory.Set("Protocol", TypeIdValue(TcpSocketFactory::GetTypeId()));
+                clientFactory.Set("DataRate", DataRateValue(DataRate(profile.rate)));
+                clientFactory.Set("PacketSize", UintegerValue(1000));
+                clientFactory.Set("OnTime", StringValue("ns3::ExponentialRandomVariable[Mean=" + to_string(profile.onTime) + "]"));
+                clientFactory.Set("OffTime", StringValue("ns3::ExponentialRandomVariable[Mean=" + to_string(profile.offTime) + "]"));
+            } else {
+                clientFactory.SetTypeId(BulkSendApplication::GetTypeId());
+                clientFactory.Set("SendSize", UintegerValue(1000));
+            }
+            clientFactory.Set("Remote", AddressValue(InetSocketAddress(dstAddress, port)));
+            clientFactory.Set("MaxBytes", UintegerValue((uint64_t) flowTable.packets[row] * 1000));
+            flow.client = CreateTcpClient(clientFactory, srcNode, profile.tcpVariant);
+        }
+
+        // Completion of every TCP flow is recorded, to compare with reliable UDP flows
+        flow.server->TraceConnectWithoutContext("Rx", MakeBoundCallback(&OnTcpRx, row));
+        if (generator != 0) {
+            return;
+        }
+
+        // Set up Tcp Troughput Trace
+        // Simulator::Schedule(MilliSeconds(LOG_INTERVAL), &LogTcpThroughput, flowTable.entry[row], StaticCast<PacketSink>(flow.server), 0);
+    }
+}
+
+uint16_t AllocateDynamicPort(FlowGenerator *generator) {
+    for (uint32_t i = 0; i < DYNAMIC_PORT_SPAN; i++) {
+        uint16_t port = generator->basePort + (generator->nextPort++ % DYNAMIC_PORT_SPAN);
+        if (generator->activePorts.insert(port).second) {
+            return port;
+        }
+    }
+    return 0;
+}
+
+uint32_t DrawFlowSize(FlowGenerator *generator) {
+    if (generator->sizeShape <= 1.0) {
+        return max<uint32_t>(1, generator->meanPackets);
+    }
+    // Pareto distributed size with the requested mean
+    double scale = generator->meanPackets * (generator->sizeShape - 1) / generator->sizeShape;
+    double packets = scale / pow(generator->size->GetValue(), 1.0 / generator->sizeShape);
+    return (uint32_t) max(1.0, min(packets, 4294967.0));
+}
+
+void StartDynamicFlow(FlowGenerator *generator) {
+    // Poisson source: arrivals are independent of the flows already running
+    if (generator->poisson) {
+        Time nextArrival = Seconds(generator->gap->GetValue());
+        if (Simulator::Now() + nextArrival < generator->stopTime) {
+            Simulator::Schedule(nextArrival, &StartDynamicFlow, generator);
+        }
+    }
+
+    uint16_t port = AllocateDynamicPort(generator);
+    if (port == 0) {
+        rejectedFlows++;
+        return;
+    }
+
+    uint8_t flags = FLOW_GENERATED | (generator->udp ? FLOW_UDP : 0);
+    uint32_t row = flowTable.Add(flags, generator->entry, generator->src, generator->dst, port, generator->profile, DrawFlowSize(generator), Simulator::Now());
+    StartFlow(row, generator);
+}
+
+// Profile of the key=value options of a flow_file entry, e.g. "tcp=Bic profile=onoff rate=5Mbps on=1 off=2".
+// Entries with the same options share a profile.
+uint16_t ParseTrafficProfile(const vector<string> &options, bool udp, uint32_t entry) {
+    TrafficProfile profile;
+    profile.kind = PROFILE_BULK;
+    profile.tcpVariant = TcpNewReno::GetTypeId(); // SocketType of the TCP configuration
+    profile.rate = "5Mbps";
+    profile.onTime = 1.0;
+    profile.offTime = 1.0;
+    profile.requestSize = 200;
+    profile.responseSize = 50000;
+    profile.thinkTime = 1.0;
+
+    for (vector<string>::const_iterator iter = options.begin(); iter != options.end(); iter++) {
+        if (iter->find('=') == string::npos) {
+            NS_FATAL_ERROR("Option of flow " << entry << " is not key=value: " << *iter);
+        }
+        if (udp) {
+            NS_FATAL_ERROR("Options of flow " << entry << " apply to TCP flows only: " << *iter);
+        }
+        string key = iter->substr(0, iter->find('='));
+        string value = iter->substr(iter->find('=') + 1);
+        if (key == "tcp") {
+            // Any TcpCongestionOps, e.g. Bic, Vegas, Westwood or ns3::TcpHighSpeed
+            string name = value.compare(0, 5, "ns3::") == 0 ? value : "ns3::Tcp" + value;
+            if (!TypeId::LookupByNameFailSafe(name, &profile.tcpVariant) ||
+                !profile.tcpVariant.IsChildOf(TcpCongestionOps::GetTypeId())) {
+                NS_FATAL_ERROR("Unknown TCP variant of flow " << entry << ": " << value);
+            }
+        } else if (key == "profile") {
+            if (value == "bulk") {
+                profile.kind = PROFILE_BULK;
+            } else if (value == "onoff") {
+                profile.kind = PROFILE_ONOFF;
+            } else if (value == "reqresp") {
+                profile.kind = PROFILE_REQRESP;
+            } else {
+                NS_FATAL_ERROR("Unknown traffic profile of flow " << entry << ": " << value);
+            }
+        } else if (key == "rate") {
+            profile.rate = value;
+        } else if (key == "on") {
+            profile.onTime = stod(value);
+        } else if (key == "off") {
+            profile.offTime = stod(value);
+        } else if (key == "request") {
+            profile.requestSize = stoul(value);
+        } else if (key == "response") {
+            profile.responseSize = stoul(value);
+        } else if (key == "think") {
+            profile.thinkTime = stod(value);
+        } else {
+            NS_FATAL_ERROR("Unknown option of flow " << entry << ": " << *iter);
+        }
+        profile.name += (profile.name.empty() ? "" : " ") + *iter;
+    }
+
+    for (uint32_t i = 0; i < trafficProfiles.size(); i++) {
+        if (trafficProfiles[i].name == profile.name) {
+            return i;
+        }
+    }
+    trafficProfiles.push_back(profile);
+    return trafficProfiles.size() - 1;
+}
+
+Time FctPercentile(const vector<Time> &sorted, double percentile) {
+    uint32_t index = min<uint32_t>(sorted.size() - 1, (uint32_t) (percentile / 100 * sorted.size()));
+    return sorted[index];
+}
+
+void ReportFlowCompletionTimes(bool udp) {
+    // Flow size buckets in packets
+    const uint32_t bucketLimits[] = { 10, 100, 1000, 0xffffffff };
+    const char *bucketNames[] = { "<10p", "<100p", "<1000p", ">=1000p" };
+    const char *protocol = udp ? "UDP" : "TCP";
+    const uint8_t protocolFlag = udp ? FLOW_UDP : 0;
+
+    for (uint32_t bucket = 0; bucket < 4; bucket++) {
+        uint32_t lowerLimit = bucket == 0 ? 0 : bucketLimits[bucket - 1];
+        vector<Time> fcts;
+        uint32_t timedOut = 0;
+        for (uint32_t row = 0; row < flowTable.GetSize(); row++) {
+            uint8_t flags = flowTable.flags[row];
+            if ((flags & (FLOW_GENERATED | FLOW_FINISHED | FLOW_UDP)) != (FLOW_GENERATED | FLOW_FINISHED | protocolFlag) ||
+                flowTable.rxBytes[row] == 0 ||
+                flowTable.packets[row] < lowerLimit || flowTable.packets[row] >= bucketLimits[bucket]) {
+                continue;
+            }
+            fcts.push_back(TimeStep(flowTable.lastRx[row] - flowTable.start[row]));
+            timedOut += (flags & FLOW_TIMED_OUT) ? 1 : 0;
+        }
+        if (fcts.empty()) {
+            continue;
+        }
+        sort(fcts.begin(), fcts.end());
+        Time sum(0);
+        for (vector<Time>::iterator iter = fcts.begin(); iter != fcts.end(); iter++) {
+            sum += *iter;
+        }
+        NS_LOG_UNCOND("(FCT)" << protocol << " " << bucketNames[bucket] << ": Flows " << fcts.size() <<
+                      " (timed out " << timedOut << ")" <<
+                      " Mean " << (sum / fcts.size()).GetMilliSeconds() << " ms" <<
+                      " P50 " << FctPercentile(fcts, 50).GetMilliSeconds() << " ms" <<
+                      " P90 " << FctPercentile(fcts, 90).GetMilliSeconds() << " ms" <<
+                      " P99 " << FctPercentile(fcts, 99).GetMilliSeconds() << " ms" <<
+                      " Max " << fcts.back().GetMilliSeconds() << " ms");
+    }
+}
+
 int main(int argc, char *argv[]) {
     /* NOTICE
     * You should use following logs for only debugging. Please disable all logs when submit!
@@ -102,10 +1621,60 @@ int main(int argc, char *argv[]) {
 
     string topologyFilename, flowFilename;
     uint32_t simulationTime = 100;
+    string queueDisc = "PfifoFast";
+    bool ecn = false, ecnScalable = false;
+    uint32_t frameRate = 0, frameDeadline = 150;
+    string frameSize;
+    bool compactFeedback = false;
+    uint32_t feedbackTos = 0;
+    bool inFlightCap = false;
+    string metricsSocketPath;
+    uint32_t metricsInterval = 100;
+    double inFlightGain = 2.0;
+    bool decisionStats = false;
+    bool feedbackWatchdog = false;
+    bool warmStart = false;
+    string warmStartFilename;
+    uint32_t flightTriggerMs = 0;
+    double flightDumpAt = 0;
+    uint32_t linkSampleInterval = 10;
+    string linkTraceFilename;
     CommandLine cmd;
     cmd.AddValue("topo_file", "The name of topology configuration file", topologyFilename);
     cmd.AddValue("flow_file", "The name of flow configuration file", flowFilename);
     cmd.AddValue("sim_time", "Simulation Time", simulationTime);
+    cmd.AddValue("queue_disc", "Root queue disc of the links without a qdisc column (PfifoFast, CoDel, FqCoDel, Pie or Red)", queueDisc);
+    cmd.AddValue("ecn", "Use ECN for UDP flows and CE marking in CoDel/Red", ecn);
+    cmd.AddValue("ecn_scalable", "Use the scalable (L4S-style) ECN response with step marking in Red", ecnScalable);
+    cmd.AddValue("multipath", "Number of subflows over link-disjoint paths for each UDP flow of flow_file", multipathCount);
+    cmd.AddValue("reliable", "Retransmit lost UDP packets reported by NACKs until every packet is delivered", reliableUdp);
+    cmd.AddValue("compact_feedback", "UDP feedback carries only the fields the controller uses (17 instead of 37 bytes)", compactFeedback);
+    cmd.AddValue("feedback_tos", "TOS of UDP feedback packets, 16 (low delay) maps to the priority band of PfifoFast", feedbackTos);
+    cmd.AddValue("feedback_watchdog", "Back off the rate of UDP flows while their feedback is missing, e.g. on return path loss", feedbackWatchdog);
+    cmd.AddValue("warm_start", "UDP flows start from the controller state of earlier flows to the same destination", warmStart);
+    cmd.AddValue("warm_start_file", "File the warm_start states are loaded from and saved to, to carry them across runs", warmStartFilename);
+    cmd.AddValue("inflight_cap", "Block UDP sending while a bandwidth-delay product is unacknowledged by feedback", inFlightCap);
+    cmd.AddValue("inflight_gain", "In-flight limit of UDP flows as a multiple of the bandwidth-delay product", inFlightGain);
+    cmd.AddValue("auto_stop", "Stop before sim_time once every flow is finished or idle for flow_idle_timeout", autoStop);
+    cmd.AddValue("converge_window", "Stop before sim_time once the throughput and delay of every flow stay steady for this many seconds, 0 to run on", convergeWindow);
+    cmd.AddValue("converge_band", "Largest standard deviation over the mean of the throughput and delay of a steady flow", convergeBand);
+    cmd.AddValue("adaptive_size", "UDP packets are sized to the sending rate, up to the MTU, instead of 1000 bytes", adaptivePacketSize);
+    cmd.AddValue("metrics_socket", "Unix datagram socket of util/metrics_view.py to publish live per-flow metrics to", metricsSocketPath);
+    cmd.AddValue("metrics_interval", "Simulation time (ms) between live metrics samples", metricsInterval);
+    cmd.AddValue("decision_stats", "Report how often each rule of the UDP rate controller fired and how it moved the send interval", decisionStats);
+    cmd.AddValue("decision_log", "Log every Nth rate decision of UDP flows with its inputs, 0 for none", decisionLog);
+    cmd.AddValue("flight_recorder", "Keep the last N packets of each static UDP flow with their queueing along the path, 0 to disable", flightRecorderSize);
+    cmd.AddValue("flight_trigger", "Dump the flight recorder of a UDP flow when a packet is delayed longer (ms), 0 for no trigger", flightTriggerMs);
+    cmd.AddValue("flight_dump_at", "Also dump the flight recorders at this simulation time (s), 0 for only at the end", flightDumpAt);
+    cmd.AddValue("flight_file", "Binary file of the flight recorder dumps, read by util/flight.py", flightFilename);
+    cmd.AddValue("link_stats", "Report utilization, queue length, sojourn time and drops of every link, and the bottleneck links", linkStatsEnabled);
+    cmd.AddValue("link_sample", "Simulation time (ms) between queue length samples of link_stats", linkSampleInterval);
+    cmd.AddValue("link_trace", "Binary file of the link_stats samples, read by util/links.py, empty for none", linkTraceFilename);
+    cmd.AddValue("delay_percentiles", "Report the P99 delay and the lost packets of each UDP flow", delayPercentiles);
+    cmd.AddValue("frame_rate", "Frames per second of UDP flows sending real-time media, 0 for bulk packets", frameRate);
+    cmd.AddValue("frame_size", "Frame size distribution in bytes, e.g. ns3::LogNormalRandomVariable[Mu=8.86|Sigma=0.5]", frameSize);
+    cmd.AddValue("frame_deadline", "Playout deadline (ms) of a frame after its capture", frameDeadline);
+    cmd.AddValue("flow_idle_timeout", "Idle time (ms) after which a generated UDP flow is considered finished", flowIdleTimeout);
     cmd.Parse(argc, argv);
 
     // TCP Configuration --> Do not modify
@@ -114,65 +1683,208 @@ int main(int argc, char *argv[]) {
     Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(1000));
     Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TypeId::LookupByName("ns3::TcpNewReno")));
 
+    // UDP ECN Configuration
+    Config::SetDefault("ns3::UdpCcController::Ecn", BooleanValue(ecn || ecnScalable));
+    Config::SetDefault("ns3::UdpCcController::EcnScalable", BooleanValue(ecnScalable));
+
+    // UDP Reliability Configuration
+    Config::SetDefault("ns3::UdpClient::Reliable", BooleanValue(reliableUdp));
+    Config::SetDefault("ns3::UdpServer::Reliable", BooleanValue(reliableUdp));
+
+    Config::SetDefault("ns3::UdpServer::DelayHistogram", BooleanValue(delayPercentiles));
+
+    // UDP Feedback Configuration
+    Config::SetDefault("ns3::UdpClient::CompactFeedback", BooleanValue(compactFeedback));
+    Config::SetDefault("ns3::UdpServer::CompactFeedback", BooleanValue(compactFeedback));
+    Config::SetDefault("ns3::UdpServer::FeedbackTos", UintegerValue(feedbackTos));
+
+    // UDP Feedback Watchdog Configuration
+    Config::SetDefault("ns3::UdpClient::FeedbackWatchdog", BooleanValue(feedbackWatchdog));
+
+    // UDP In-flight Cap Configuration
+    Config::SetDefault("ns3::UdpClient::InFlightCap", BooleanValue(inFlightCap));
+    Config::SetDefault("ns3::UdpClient::InFlightGain", DoubleValue(inFlightGain));
+
+    // UDP Rate Decision Configuration
+    Config::SetDefault("ns3::UdpCcController::DecisionSampling", UintegerValue(decisionLog));
+
+    // UDP Packet Size Configuration
+    Config::SetDefault("ns3::UdpClient::AdaptiveSize", BooleanValue(adaptivePacketSize));
+
+    // UDP Real-time Media Configuration
+    if (frameRate > 0 && (reliableUdp || adaptivePacketSize)) {
+        NS_FATAL_ERROR("frame_rate cannot be combined with reliable or adaptive_size");
+    }
+    Config::SetDefault("ns3::UdpClient::FrameRate", UintegerValue(frameRate));
+    Config::SetDefault("ns3::UdpClient::FrameDeadline", TimeValue(MilliSeconds(frameDeadline)));
+    Config::SetDefault("ns3::UdpServer::FrameDeadline", TimeValue(frameRate > 0 ? MilliSeconds(frameDeadline) : Seconds(0)));
+    if (!frameSize.empty()) {
+        Config::SetDefault("ns3::UdpClient::FrameSize", StringValue(frameSize));
+    }
+
     // Set Topology
+    SystemWallClockMs setupClock;
+    setupClock.Start();
+
     std::ifstream topologyFile;
     uint32_t nodeNum, switchNum, linkNum;
     topologyFile.open(topologyFilename.c_str());
     topologyFile >> nodeNum >> switchNum >> linkNum;
 
-    NodeContainer nodes;
-    nodes.Create(nodeNum);
-
     // To distinguish switch nodes from host nodes
     std::vector<uint32_t> nodeType(nodeNum, 0);
+    nodeLinks.resize(nodeNum);
     for (uint32_t i = 0; i < switchNum; i++) {
         uint32_t sid;
         topologyFile >> sid;
         nodeType[sid] = 1;
     }
 
-    InternetStackHelper internet;
-    internet.Install(nodes);
+    vector<LinkSpec> linkSpecs(linkNum);
+    for (uint32_t i = 0; i < linkNum; i++) {
+        LinkSpec &spec = linkSpecs[i];
+        string line;
+        do {
+            getline(topologyFile, line);
+        } while (topologyFile && line.find_first_not_of(" \t\r") == string::npos);
+        istringstream entry(line);
+        entry >> spec.src >> spec.dst >> spec.bandwidth >> spec.delay;
 
-    Ipv4AddressHelper address;
-    address.SetBase("10.0.0.0", "255.255.255.0");
+        // Optional key=value columns
+        string option;
+        spec.traceStep = MilliSeconds(100);
+        spec.queueDisc = queueDisc;
+        spec.queueLimit = "50p";
+        spec.deviceQueueLimit = "50p";
+        spec.errorRate[0] = spec.errorRate[1] = 0;
+        spec.errorStart = spec.errorStop = Time(0);
+        while (entry >> option) {
+            string key = option.substr(0, option.find('='));
+            string value = option.substr(option.find('=') + 1);
+            if (key == "trace") {
+                // Relative to the directory of topo_file
+                spec.traceFilename = value[0] == '/' ? value : topologyFilename.substr(0, topologyFilename.find_last_of('/') + 1) + value;
+            } else if (key == "trace_step") {
+                spec.traceStep = Time(value);
+            } else if (key == "qdisc") {
+                spec.queueDisc = value;
+            } else if (key == "queue") {
+                spec.queueLimit = value;
+            } else if (key == "device_queue") {
+                spec.deviceQueueLimit = value;
+            } else if (key == "error") {
+                spec.errorRate[0] = stod(value);
+            } else if (key == "reverse_error") {
+                spec.errorRate[1] = stod(value);
+            } else if (key == "error_start") {
+                spec.errorStart = Time(value);
+            } else if (key == "error_stop") {
+                spec.errorStop = Time(value);
+            } else if (key.compare(0, 6, "qdisc.") == 0) {
+                // Any attribute of the queue disc, e.g. qdisc.Target=5ms for CoDel
+                spec.queueDiscAttributes.push_back(make_pair(key.substr(6), value));
+            } else {
+                NS_FATAL_ERROR("Unknown option of link " << i << ": " << option);
+            }
+        }
+    }
+    LogSetupPhase(setupClock, "Topology parse");
 
-    // Assume that each host nodes (server/client nodes) connects to a single switch in this project
-    std::vector<Ipv4Address> serverAddresses(nodeNum, Ipv4Address());
+    uint64_t rssStart, rssNodes, rssLinks, rssPeak;
+    ReadResidentMemory(rssStart, rssPeak);
 
-    for (uint32_t i = 0; i < linkNum; i++) {
-        uint32_t src, dst;
-        string bandwidth, linkDelay;
-        topologyFile >> src >> dst >> bandwidth >> linkDelay;
+    NodeContainer nodes;
+    nodes.Create(nodeNum);
 
-        DataRate rate(bandwidth);
-        Time delay(linkDelay);
+    // Scenarios are IPv4-only, so skip the IPv6 stack and its per-node state
+    InternetStackHelper internet;
+    internet.SetIpv6StackInstall(false);
+    internet.Install(nodes);
+    ReadResidentMemory(rssNodes, rssPeak);
+    LogSetupPhase(setupClock, "Stack install");
 
-        PointToPointHelper p2p;
-        p2p.SetDeviceAttribute("DataRate", StringValue(bandwidth));
-        p2p.SetChannelAttribute("Delay", StringValue(linkDelay));
-        p2p.SetQueue("ns3::DropTailQueue", "MaxSize", QueueSizeValue(QueueSize("50p")));
+    // One helper for all links, and the devices of the links sharing a queue disc configuration
+    // are collected to install their queue discs in one batch
+    PointToPointHelper p2p;
+    vector<NetDeviceContainer> linkDevices(linkNum);
+    map<string, pair<uint32_t, NetDeviceContainer> > queueDiscGroups;
+    for (uint32_t i = 0; i < linkNum; i++) {
+        const LinkSpec &spec = linkSpecs[i];
+        p2p.SetDeviceAttribute("DataRate", StringValue(spec.bandwidth));
+        p2p.SetChannelAttribute("Delay", StringValue(spec.delay));
+        p2p.SetQueue("ns3::DropTailQueue", "MaxSize", QueueSizeValue(QueueSize(spec.deviceQueueLimit)));
 
         // p2p.EnablePcapAll("Test");
 
-        NetDeviceContainer devices = p2p.Install(nodes.Get(src), nodes.Get(dst));
+        linkDevices[i] = p2p.Install(nodes.Get(spec.src), nodes.Get(spec.dst));
+        InstallLinkErrors(spec, linkDevices[i]);
 
-        /* Install Traffic Controller
-        * Do not disable traffic controller.
-        * Packets are enqueued in a new efficient queue instead of Netdevice's droptail queue.
-        * But if you want to use different Queue Disc like CoDel and RED, you can use it!
-        * Max Size should be the same as 50p
-        * You should write the reason why use other queue disc than PfifoFastQueueDisc in report and presentation ppt material.
-        */
+        string key = QueueDiscKey(spec);
+        if (queueDiscGroups.find(key) == queueDiscGroups.end()) {
+            queueDiscGroups[key].first = i;
+        }
+        queueDiscGroups[key].second.Add(linkDevices[i]);
+
+        if (!spec.traceFilename.empty()) {
+            TracedLink tracedLink;
+            tracedLink.device[0] = DynamicCast<PointToPointNetDevice>(linkDevices[i].Get(0));
+            tracedLink.device[1] = DynamicCast<PointToPointNetDevice>(linkDevices[i].Get(1));
+            tracedLink.channel = DynamicCast<PointToPointChannel>(linkDevices[i].Get(0)->GetChannel());
+            tracedLink.trace = LoadLinkTrace(spec.traceFilename, spec.traceStep);
+            Simulator::Schedule(tracedLink.trace->at[0], &ApplyLinkTraceStep, (uint32_t) tracedLinks.size(), (uint32_t) 0);
+            tracedLinks.push_back(tracedLink);
+        }
+    }
+    LogSetupPhase(setupClock, "Link creation");
+
+    /* Install Traffic Controller
+    * Do not disable traffic controller.
+    * Packets are enqueued in a new efficient queue instead of Netdevice's droptail queue.
+    * But if you want to use different Queue Disc like CoDel and RED, you can use it!
+    * Max Size should be the same as 50p
+    * You should write the reason why use other queue disc than PfifoFastQueueDisc in report and presentation ppt material.
+    */
+    for (map<string, pair<uint32_t, NetDeviceContainer> >::iterator group = queueDiscGroups.begin(); group != queueDiscGroups.end(); group++) {
+        const LinkSpec &spec = linkSpecs[group->second.first];
         TrafficControlHelper tch;
-        tch.SetRootQueueDisc("ns3::PfifoFastQueueDisc", "MaxSize", QueueSizeValue(QueueSize("50p"))); // ns3 default queue disc
-        // tch.SetRootQueueDisc("ns3::CoDelQueueDisc", "MaxSize", QueueSizeValue(QueueSize("50p")); // CoDel queue disc
-        // tch.SetRootQueueDisc("ns3::RedQueueDisc", "MaxSize", QueueSizeValue(QueueSize("50p")); // RED queue disc
-        // tch.SetRootQueueDisc("ns3::...")
-        tch.Install(devices);
+        SetRootQueueDisc(tch, spec, ecn, ecnScalable);
+        QueueDiscContainer queueDiscs = tch.Install(group->second.second);
+
+        // AQM parameters are read when the queue discs are initialized at the start of the simulation
+        for (vector< pair<string, string> >::const_iterator iter = spec.queueDiscAttributes.begin(); iter != spec.queueDiscAttributes.end(); iter++) {
+            for (uint32_t j = 0; j < queueDiscs.GetN(); j++) {
+                queueDiscs.Get(j)->SetAttribute(iter->first, StringValue(iter->second));
+            }
+        }
+    }
+    LogSetupPhase(setupClock, "Queue disc install");
+
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.255.255.0");
 
-        Ipv4InterfaceContainer ipv4 = address.Assign(devices);
+    // Assume that each host nodes (server/client nodes) connects to a single switch in this project
+    std::vector<Ipv4Address> serverAddresses(nodeNum, Ipv4Address());
+
+    for (uint32_t i = 0; i < linkNum; i++) {
+        uint32_t src = linkSpecs[i].src, dst = linkSpecs[i].dst;
+        Ipv4InterfaceContainer ipv4 = address.Assign(linkDevices[i]);
         address.NewNetwork();
+        if (flightRecorderSize > 0) {
+            InstallFlightHooks(i, linkDevices[i]);
+        }
+        if (linkStatsEnabled) {
+            InstallLinkStats(i, linkDevices[i], src, dst);
+        }
+
+        TopologyLink link;
+        for (uint32_t side = 0; side < 2; side++) {
+            link.node[side] = side == 0 ? src : dst;
+            link.address[side] = ipv4.GetAddress(side);
+            link.ifIndex[side] = ipv4.Get(side).second;
+        }
+        nodeLinks[src].push_back(topologyLinks.size());
+        nodeLinks[dst].push_back(topologyLinks.size());
+        topologyLinks.push_back(link);
 
         // Store addresses of servers for installing applications later.
         if (nodeType[src] == 0 || nodeType[dst] == 0) {
@@ -181,8 +1893,19 @@ int main(int argc, char *argv[]) {
             serverAddresses[hostId] = ipv4.GetAddress(hostIndex);
         }
     }
+    linkSpecs.clear();
+    linkDevices.clear();
+    queueDiscGroups.clear();
+    ReadResidentMemory(rssLinks, rssPeak);
+    LogSetupPhase(setupClock, "Address assignment");
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    LogSetupPhase(setupClock, "Routing");
+
+    for (uint32_t i = 0; i < nodeNum; i++) {
+        flowNodes.push_back(nodes.Get(i));
+    }
+    flowAddresses = serverAddresses;
 
     // Set Flows
     std::ifstream flowFile;
@@ -190,95 +1913,263 @@ int main(int argc, char *argv[]) {
     flowFile.open(flowFilename.c_str());
     flowFile >> flowNum;
 
-    list< Ptr<Application> > apps;
-    list<Time> appsStart;
-    list<bool> appsType;
-
     for (uint32_t i = 0; i < flowNum; i++) {
-        string protocol;
+        string protocol, arrival;
         uint32_t src, dst, port, maxPacketCount;
         double startTime;
 
-        flowFile >> protocol >> src >> dst >> port >> maxPacketCount >> startTime;
+        string line;
+        do {
+            getline(flowFile, line);
+        } while (flowFile && line.find_first_not_of(" \t\r") == string::npos);
+        istringstream entry(line);
+        entry >> protocol >> src >> dst >> port >> maxPacketCount >> startTime;
 
-        // Do not modify parameters of TCP
-        if (protocol == "TCP") {
-            Address sinkLocalAddress(InetSocketAddress(Ipv4Address::GetAny(), port));
-            PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", sinkLocalAddress);
-            sinkHelper.SetAttribute("Protocol", TypeIdValue(TcpSocketFactory::GetTypeId()));
-            ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(dst));
-            sinkApp.Start(Seconds(startTime));
-
-            AddressValue remoteAddress(InetSocketAddress(serverAddresses[dst], port));
-            BulkSendHelper ftp("ns3::TcpSocketFactory", Address());
-            ftp.SetAttribute("Remote", remoteAddress);
-            ftp.SetAttribute("SendSize", UintegerValue(1000));
-            ftp.SetAttribute("MaxBytes", UintegerValue(maxPacketCount * 1000));
-            ApplicationContainer sourceApp = ftp.Install(nodes.Get(src));
-            sourceApp.Start(Seconds(startTime));
-
-            // Set up Tcp Troughput Trace
-            // Simulator::Schedule(Seconds(startTime) + MilliSeconds(LOG_INTERVAL), &LogTcpThroughput, i, StaticCast<PacketSink>(sinkApp.Get(0)), 0);
-
-            apps.push_back(sinkApp.Get(0));
-            appsStart.push_back(Seconds(startTime));
-            appsType.push_back(false);
-        } else {
-            // You can add/remove/change parameters of UDP
-            UdpServerHelper server(port);
-            ApplicationContainer serverApp = server.Install(nodes.Get(dst));
-            serverApp.Start(Seconds(startTime));
+        // Columns after startTime: the arrival process of generated flows, then key=value options
+        vector<string> options;
+        string option;
+        while (entry >> option) {
+            options.push_back(option);
+        }
+        if (!options.empty() && options[0].find('=') == string::npos) {
+            // Generated short flows: maxPacketCount is the mean flow size
+            if (options.size() < 4) {
+                NS_FATAL_ERROR("Flow " << i << " needs arrival stopTime arrivalParam sizeShape");
+            }
+            arrival = options[0];
+            double stopTime = stod(options[1]), arrivalParam = stod(options[2]), sizeShape = stod(options[3]);
+            options.erase(options.begin(), options.begin() + 4);
 
-            UdpClientHelper client(serverAddresses[dst], port);
-            client.SetAttribute("MaxPackets", UintegerValue(maxPacketCount));
-            // client.SetAttribute("Interval", TimeValue(MilliSeconds(1))); // Managed by application-level congestion controller
-            client.SetAttribute("PacketSize", UintegerValue(1000)); // Do not modify
-            ApplicationContainer clientApp = client.Install(nodes.Get(src));
-            clientApp.Start(Seconds(startTime));
+            FlowGenerator generator;
+            generator.entry = i;
+            generator.udp = (protocol == "UDP");
+            generator.profile = ParseTrafficProfile(options, generator.udp, i);
+            generator.poisson = (arrival == "poisson");
+            generator.src = src;
+            generator.dst = dst;
+            generator.basePort = port;
+            generator.nextPort = 0;
+            generator.meanPackets = maxPacketCount;
+            generator.sizeShape = sizeShape;
+            generator.stopTime = Seconds(stopTime);
+            generator.gap = CreateObject<ExponentialRandomVariable>();
+            generator.gap->SetAttribute("Mean", DoubleValue(generator.poisson ? 1.0 / arrivalParam : arrivalParam));
+            generator.size = CreateObject<UniformRandomVariable>();
+            flowGenerators.push_back(generator);
 
-            // Set up Udp Troughput Trace
-            // Simulator::Schedule(Seconds(startTime) + MilliSeconds(LOG_INTERVAL), &LogUdpThroughput, i, StaticCast<UdpServer>(serverApp.Get(0)), 0);
+            Simulator::Schedule(Seconds(startTime), &StartDynamicFlow, &flowGenerators.back());
+            continue;
+        }
 
-            // Set up Udp Delay Trace
-            // serverApp.Get(0)->TraceConnect("Delay", to_string(i), MakeCallback(&LogUdpDelay));
+        // Applications are created when the flow starts
+        uint8_t flags = (protocol == "UDP") ? FLOW_UDP : 0;
+        uint16_t profile = ParseTrafficProfile(options, flags & FLOW_UDP, i);
+        uint32_t row = flowTable.Add(flags, i, src, dst, port, profile, maxPacketCount, Seconds(startTime));
+        Simulator::Schedule(Seconds(startTime), &StartFlow, row, (FlowGenerator *) 0);
+    }
 
-            // Set up Udp Trendline Slope Trace
-            // clientApp.Get(0)->TraceConnect("TrendlineSlope", to_string(i), MakeCallback(&LogUdpTrendline));
-            // clientApp.Get(0)->TraceConnect("Interval", to_string(i), MakeCallback(&LogUdpInterval));
-            // clientApp.Get(0)->TraceConnect("Lost", to_string(i), MakeCallback(&LogUdpLost));
-            // clientApp.Get(0)->TraceConnect("TargetInterval", to_string(i), MakeCallback(&LogUdpTargetInterval));
+    LogSetupPhase(setupClock, "App install");
 
-            apps.push_back(serverApp.Get(0));
-            appsStart.push_back(Seconds(startTime));
-            appsType.push_back(true);
+    if (!metricsSocketPath.empty()) {
+        metricsSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (metricsSocket < 0 || metricsSocketPath.size() >= sizeof(metricsAddress.sun_path)) {
+            NS_FATAL_ERROR("Cannot publish metrics to " << metricsSocketPath);
         }
+        memset(&metricsAddress, 0, sizeof(metricsAddress));
+        metricsAddress.sun_family = AF_UNIX;
+        strncpy(metricsAddress.sun_path, metricsSocketPath.c_str(), sizeof(metricsAddress.sun_path) - 1);
+        metricsPeriod = MilliSeconds(max<uint32_t>(1, metricsInterval));
+        Simulator::Schedule(metricsPeriod, &PublishMetrics);
+    }
+
+    if (autoStop || convergeWindow > 0) {
+        Simulator::Schedule(MilliSeconds(AUTO_STOP_PERIOD), &CheckAutoStop);
+    }
+
+    if (warmStart) {
+        stateCache = CreateObject<UdpCcStateCache>();
+        if (!warmStartFilename.empty()) {
+            NS_LOG_UNCOND("(WARM) Loaded " << stateCache->Load(warmStartFilename) << " destination states from " << warmStartFilename);
+        }
+    }
+
+    if (linkStatsEnabled) {
+        linkSamplePeriod = MilliSeconds(max<uint32_t>(1, linkSampleInterval));
+        linkLastSample = Simulator::Now();
+        if (!linkTraceFilename.empty()) {
+            linkTraceFile.open(linkTraceFilename.c_str(), ios::binary | ios::trunc);
+        }
+        Simulator::Schedule(linkSamplePeriod, &ScheduleLinkSample);
+    }
+
+    flightTrigger = MilliSeconds(flightTriggerMs);
+    if (flightRecorderSize > 0 && flightDumpAt > 0) {
+        Simulator::Schedule(Seconds(flightDumpAt), &DumpAllFlights, (uint8_t) FLIGHT_DUMP_AT);
     }
 
     Simulator::Stop(Seconds(simulationTime));
     Simulator::Run();
 
-    list< Ptr<Application> >::iterator appsIter = apps.begin();
-    list<Time>::iterator appsStartIter = appsStart.begin();
-    list<bool>::iterator appsTypeIter = appsType.begin();
-    int cnt = 0;
+    // Results are over the simulated time, which ends early when stopped automatically
+    Time endTime = Simulator::Now();
+    if (!stopReason.empty()) {
+        NS_LOG_UNCOND("(STOP) " << stopReason << ", stopped at " << endTime.GetSeconds() << " s of " << simulationTime << " s");
+    }
+
+    if (metricsSocket >= 0) {
+        close(metricsSocket);
+    }
+
+    if (linkStatsEnabled) {
+        PrintLinkStats();
+        linkTraceFile.close();
+    }
+
+    if (flightRecorderSize > 0) {
+        DumpAllFlights(FLIGHT_DUMP_END);
+        flightFile.close();
+        NS_LOG_UNCOND("(FLIGHT) " << flightDumps << " dumps of the last " << flightRecorderSize << " packets written to " << flightFilename);
+    }
+
+    // Collect results of the flows still running
+    for (map<uint32_t, ActiveFlow>::iterator iter = activeFlows.begin(); iter != activeFlows.end(); iter++) {
+        HarvestFlow(iter->first, iter->second);
+    }
 
     // Print throughput and delay
-    for ( ; appsIter != apps.end() && appsTypeIter != appsType.end() && appsStartIter != appsStart.end();
-            appsIter++, appsStartIter++, appsTypeIter++, cnt++) {
-        if (*appsTypeIter) {
+    uint64_t udpTotalRx = 0;
+    for (uint32_t row = 0; row < flowTable.GetSize(); row++) {
+        uint8_t flags = flowTable.flags[row];
+        if ((flags & FLOW_GENERATED) || !(flags & FLOW_STARTED)) {
+            continue;
+        }
+        uint32_t entry = flowTable.entry[row];
+        Time duration = max(endTime - TimeStep(flowTable.start[row]), NanoSeconds(1));
+        // Goodput of a finished flow is over its completion time, otherwise over the rest of the run
+        Time completion = (flags & FLOW_FINISHED) ? TimeStep(flowTable.lastRx[row] - flowTable.start[row]) : duration;
+        completion = max(completion, NanoSeconds(1));
+        if (flags & FLOW_UDP) {
             // UDP
-            uint64_t totalRx = (StaticCast<UdpServer>(*appsIter))->GetTotalRx();
-            Time duration = Seconds(simulationTime) - (*appsStartIter);
-            NS_LOG_UNCOND("(UDP)" << cnt << ": Throughput " << (totalRx * 8) / (duration.GetSeconds() * 1000) << " Kbps");
-            NS_LOG_UNCOND("(UDP)" << cnt << ": Delay      " << (StaticCast<UdpServer>(*appsIter))->GetDelayAvg().GetMilliSeconds() << " ms");
+            NS_LOG_UNCOND("(UDP)" << entry << ": Throughput " << (flowTable.rxBytes[row] * 8) / (duration.GetSeconds() * 1000) << " Kbps");
+            NS_LOG_UNCOND("(UDP)" << entry << ": Delay      " << TimeStep(flowTable.delay[row]).GetMilliSeconds() << " ms");
+            if (delayPercentiles) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Delay P99  " << TimeStep(flowTable.delayP99[row]).GetMicroSeconds() / 1000.0 << " ms");
+                NS_LOG_UNCOND("(UDP)" << entry << ": Lost       " << flowTable.lost[row] << " of " <<
+                              flowTable.lost[row] + flowTable.rxPackets[row] << " packets");
+            }
+            udpTotalRx += flowTable.rxBytes[row];
+            if (reliableUdp) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Goodput    " << (flowTable.delivered[row] * 8) / (completion.GetSeconds() * 1000) << " Kbps" <<
+                              " (retransmitted " << flowTable.retransmitted[row] << ")");
+            }
+            if (flags & FLOW_FINISHED) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Completion " << completion.GetMilliSeconds() << " ms");
+            }
+
+            const UdpFlowReport &report = flowTable.udpReports[row];
+
+            // Control loop latency and the rate oscillation it causes
+            NS_LOG_UNCOND("(UDP)" << entry << ": Feedback   delay " << TimeStep(report.feedbackDelay).GetMicroSeconds() / 1000.0 << " ms" <<
+                          " interval deviation " << TimeStep(report.intervalDeviation).GetMicroSeconds() << " us");
+            if (inFlightCap) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Cap blocked " << report.capBlocked << " times");
+            }
+            if (feedbackWatchdog) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Watchdog   " << report.feedbackTimeouts << " backoffs");
+            }
+            if (adaptivePacketSize) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Packets    " << flowTable.rxPackets[row] <<
+                              " received, average size " << report.averagePacketSize << " bytes");
+            }
+
+            // Rules of the rate controller behind the throughput, summed over the subflows
+            if (decisionStats) {
+                for (uint8_t reason = 0; reason < UdpCcController::DECISION_REASONS; reason++) {
+                    if (report.decisionCount[reason] > 0) {
+                        Time delta = TimeStep(report.decisionDelta[reason]);
+                        NS_LOG_UNCOND("(UDP)" << entry << ": Decision   " << UdpCcController::GetDecisionName(reason) << " " <<
+                                      report.decisionCount[reason] << " times, interval " << (delta > Time(0) ? "+" : "") <<
+                                      delta.GetMicroSeconds() << " us");
+                    }
+                }
+            }
+
+            // Deadline statistics of a real-time media flow
+            if (frameRate > 0) {
+                NS_LOG_UNCOND("(UDP)" << entry << ": Frames     " << report.frames <<
+                              " on time " << report.framesOnTime <<
+                              " late " << report.framesLate <<
+                              " skipped " << report.skippedFrames);
+                NS_LOG_UNCOND("(UDP)" << entry << ": Frame latency P50 " << TimeStep(report.frameLatency[0]).GetMilliSeconds() << " ms" <<
+                              " P95 " << TimeStep(report.frameLatency[1]).GetMilliSeconds() << " ms" <<
+                              " P99 " << TimeStep(report.frameLatency[2]).GetMilliSeconds() << " ms");
+                NS_LOG_UNCOND("(UDP)" << entry << ": Stalls     " << report.stalls <<
+                              " (" << TimeStep(report.stallTime).GetMilliSeconds() << " ms)");
+            }
+
+            // Statistics of each subflow of a multipath flow
+            for (uint32_t path = 0; path < report.paths.size(); path++) {
+                NS_LOG_UNCOND("(UDP)" << entry << " path " << path << ": Throughput " <<
+                              (report.paths[path].rxBytes * 8) / (duration.GetSeconds() * 1000) << " Kbps" <<
+                              " Delay " << TimeStep(report.paths[path].delay).GetMilliSeconds() << " ms" <<
+                              " Lost " << report.paths[path].lost);
+            }
         } else {
             // TCP
-            uint64_t totalRx = (StaticCast<PacketSink>(*appsIter))->GetTotalRx();
-            Time duration = Seconds(simulationTime) - (*appsStartIter);
-            NS_LOG_UNCOND("(TCP)" << cnt << ": Throughput " << (totalRx * 8) / (duration.GetSeconds() * 1000) << " Kbps");
+            const string &profile = trafficProfiles[flowTable.profile[row]].name;
+            NS_LOG_UNCOND("(TCP)" << entry << ": Throughput " << (flowTable.rxBytes[row] * 8) / (duration.GetSeconds() * 1000) << " Kbps" <<
+                          (profile.empty() ? "" : " (" + profile + ")"));
+            if (flags & FLOW_FINISHED) {
+                NS_LOG_UNCOND("(TCP)" << entry << ": Goodput    " << (flowTable.rxBytes[row] * 8) / (completion.GetSeconds() * 1000) << " Kbps");
+                NS_LOG_UNCOND("(TCP)" << entry << ": Completion " << completion.GetMilliSeconds() << " ms");
+            }
         }
     }
 
+    if (multipathCount > 1) {
+        NS_LOG_UNCOND("(UDP) Aggregate throughput " << (udpTotalRx * 8) / (endTime.GetSeconds() * 1000) << " Kbps");
+    }
+
+    // Print flow completion time distributions of generated flows
+    if (!flowGenerators.empty()) {
+        uint32_t completed = 0, unfinished = 0;
+        for (uint32_t row = 0; row < flowTable.GetSize(); row++) {
+            if (flowTable.flags[row] & FLOW_GENERATED) {
+                completed += (flowTable.flags[row] & FLOW_FINISHED) ? 1 : 0;
+                unfinished += (flowTable.flags[row] & FLOW_FINISHED) ? 0 : 1;
+            }
+        }
+        NS_LOG_UNCOND("(FCT) Completed " << completed << " Unfinished " << unfinished <<
+                      " Rejected " << rejectedFlows);
+        ReportFlowCompletionTimes(true);
+        ReportFlowCompletionTimes(false);
+    }
+
+    for (map<uint32_t, ActiveFlow>::iterator iter = activeFlows.begin(); iter != activeFlows.end(); iter++) {
+        TearDownApplication(iter->second.client);
+        TearDownApplication(iter->second.server);
+    }
+    activeFlows.clear();
+    flowGenerators.clear();
+
+    // Torn down clients stored their last state in the cache
+    if (stateCache != 0 && !warmStartFilename.empty()) {
+        stateCache->Save(warmStartFilename);
+        NS_LOG_UNCOND("(WARM) Saved " << stateCache->GetSize() << " destination states to " << warmStartFilename);
+    }
+    stateCache = 0;
+
+    // Print memory footprint
+    uint64_t rssEnd;
+    ReadResidentMemory(rssEnd, rssPeak);
+    NS_LOG_UNCOND("(MEM) Per flow: " << FlowTable::GetRowSize() << " bytes recorded, " <<
+                  flowTable.GetSize() << " flows, peak " << peakActiveFlows << " active");
+    NS_LOG_UNCOND("(MEM) Per active flow: " << sizeof(ActiveFlow) + sizeof(UdpServer) + sizeof(UdpClient) <<
+                  " bytes of UDP application state excluding sockets");
+    NS_LOG_UNCOND("(MEM) Per node: " << (rssNodes - rssStart) * 1024 / max<uint32_t>(1, nodeNum) << " bytes");
+    NS_LOG_UNCOND("(MEM) Per link: " << (rssLinks - rssNodes) * 1024 / max<uint32_t>(1, linkNum) << " bytes");
+    NS_LOG_UNCOND("(MEM) Resident: " << rssEnd << " kB, peak " << rssPeak << " kB");
+
     Simulator::Destroy();
     return 0;
 }
@@ -28,22 +28,27 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/net-device.h"
 #include "ns3/udp-cc-header.h"
 #include "udp-client.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <ostream>
 
-#define SMOOTH(x, y, xr, yr) ((((x) * (xr)) + ((y) * (yr))) / ((xr) + (yr)))
-
-// Receiver feedback message structure
-typedef union {
-    uint8_t buf[12];
-    struct {
-        int64_t recvTime;
-        uint32_t lost;
-    };
-} message_t;
+// Sent packets remembered per subflow to interpret compact feedback
+#define SENT_LOG_SIZE 1024
+#define STATE_STORE_PERIOD 100 // ms between the states a subflow stores in the state cache
 
 namespace ns3 {
 
@@ -70,22 +75,129 @@ namespace ns3 {
                           MakeUintegerAccessor(&UdpClient::m_peerPort),
                           MakeUintegerChecker<uint16_t>())
             .AddAttribute("PacketSize",
-                          "Size of packets generated. The minimum packet size is 12 bytes which is the size of the header carrying the sequence number and the time stamp.",
+                          "Size of packets generated. The minimum packet size is 21 bytes which is the size of the header carrying the sequence number, the time stamp, the send interval and the path.",
                           UintegerValue(1024),
                           MakeUintegerAccessor(&UdpClient::m_size),
-                          MakeUintegerChecker<uint32_t>(12,65507))
+                          MakeUintegerChecker<uint32_t>(21,65507))
+            .AddAttribute("AdaptiveSize",
+                          "Size packets to the sending rate, which the controller sets in packets of PacketSize",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpClient::m_adaptiveSize),
+                          MakeBooleanChecker())
+            .AddAttribute("MinPacketSize",
+                          "The smallest packet with adaptive packet size",
+                          UintegerValue(100),
+                          MakeUintegerAccessor(&UdpClient::m_minSize),
+                          MakeUintegerChecker<uint32_t>(21,65507))
+            .AddAttribute("MaxPacketSize",
+                          "The largest packet with adaptive packet size, 0 for the MTU of the outgoing device less the IPv4 and UDP headers",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&UdpClient::m_maxSize),
+                          MakeUintegerChecker<uint32_t>(0,65507))
+            .AddAttribute("AdaptiveGap",
+                          "The time between packets that adaptive packet size aims at",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&UdpClient::m_adaptiveGap),
+                          MakeTimeChecker())
+            .AddAttribute("Coupled",
+                          "Couple the rate increases of the subflows so that all paths together are not more aggressive than one flow",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&UdpClient::m_coupled),
+                          MakeBooleanChecker())
+            .AddAttribute("Reliable",
+                          "Resend the packets the server reports missing until every packet is delivered",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpClient::m_reliable),
+                          MakeBooleanChecker())
+            .AddAttribute("RetransmitBufferSize",
+                          "The maximum number of unacknowledged packets per subflow in reliable mode",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&UdpClient::m_bufferSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("CompactFeedback",
+                          "The server sends the compact feedback header instead of echoing the data header",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpClient::m_compactFeedback),
+                          MakeBooleanChecker())
+            .AddAttribute("InFlightCap",
+                          "Block sending while the bytes not yet reported by feedback exceed the bandwidth-delay product",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpClient::m_inFlightCap),
+                          MakeBooleanChecker())
+            .AddAttribute("InFlightGain",
+                          "The in-flight limit as a multiple of the estimated bandwidth-delay product",
+                          DoubleValue(2.0),
+                          MakeDoubleAccessor(&UdpClient::m_inFlightGain),
+                          MakeDoubleChecker<double>(1.0))
+            .AddAttribute("FeedbackWatchdog",
+                          "Back off the sending rate of a subflow while its feedback is missing, until feedback resumes",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpClient::m_feedbackWatchdog),
+                          MakeBooleanChecker())
+            .AddAttribute("FeedbackTimeoutMin",
+                          "The shortest time without feedback before a backoff, the timeout is otherwise two round trips and four feedback gaps",
+                          TimeValue(MilliSeconds(50)),
+                          MakeTimeAccessor(&UdpClient::m_feedbackTimeoutMin),
+                          MakeTimeChecker(MilliSeconds(1)))
+            .AddAttribute("DeadmanBackoff",
+                          "The factor applied to the send interval at every feedback timeout",
+                          DoubleValue(2.0),
+                          MakeDoubleAccessor(&UdpClient::m_deadmanBackoff),
+                          MakeDoubleChecker<double>(1.0))
+            .AddAttribute("DeadmanMaxInterval",
+                          "The largest send interval the backoff reaches",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&UdpClient::m_deadmanMaxInterval),
+                          MakeTimeChecker())
+            .AddAttribute("StateCache",
+                          "Controller states per destination to start from instead of the bootstrap ramp, updated by this client",
+                          PointerValue(),
+                          MakePointerAccessor(&UdpClient::m_stateCache),
+                          MakePointerChecker<UdpCcStateCache>())
+            .AddAttribute("FrameRate",
+                          "Frames per second of the real-time media source, 0 to send packets back to back",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&UdpClient::m_frameRate),
+                          MakeUintegerChecker<uint32_t>(0,1000))
+            .AddAttribute("FrameSize",
+                          "A RandomVariableStream used to pick the size of each frame in bytes",
+                          StringValue("ns3::LogNormalRandomVariable[Mu=8.86|Sigma=0.5]"),
+                          MakePointerAccessor(&UdpClient::m_frameSize),
+                          MakePointerChecker<RandomVariableStream>())
+            .AddAttribute("FrameDeadline",
+                          "The playout deadline of a frame after its capture",
+                          TimeValue(MilliSeconds(150)),
+                          MakeTimeAccessor(&UdpClient::m_frameDeadline),
+                          MakeTimeChecker())
+            .AddAttribute("ScaleFrames",
+                          "Scale frames down to the per-frame budget of the current sending rate",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&UdpClient::m_scaleFrames),
+                          MakeBooleanChecker())
+            .AddTraceSource("Tx", "A packet is about to be sent, including retransmissions",
+                            MakeTraceSourceAccessor(&UdpClient::m_txTrace),
+                            "ns3::Packet::TracedCallback")
             .AddTraceSource("TrendlineSlope", "A trendline slope when packet has been received",
-                            MakeTraceSourceAccessor(&UdpClient::m_trendlineSlope),
+                            MakeTraceSourceAccessor(&UdpClient::m_trendlineSlopeTrace),
                             "ns3::TracedValueCallback::Double")
             .AddTraceSource("Interval", "The time to wait between packets",
-                            MakeTraceSourceAccessor(&UdpClient::m_interval),
+                            MakeTraceSourceAccessor(&UdpClient::m_intervalTrace),
                             "ns3::TracedValueCallback::Time")
             .AddTraceSource("Lost", "The number of lost packets when packet has been received",
                             MakeTraceSourceAccessor(&UdpClient::m_lostTrace),
                             "ns3::TracedValueCallback::Uint32")
             .AddTraceSource("TargetInterval", "The number of lost packets when packet has been received",
-                            MakeTraceSourceAccessor(&UdpClient::m_targetInterval),
+                            MakeTraceSourceAccessor(&UdpClient::m_targetIntervalTrace),
                             "ns3::TracedValueCallback::Time")
+            .AddTraceSource("Ce", "The number of congestion experienced marks when packet has been received",
+                            MakeTraceSourceAccessor(&UdpClient::m_ceTrace),
+                            "ns3::TracedValueCallback::Uint32")
+            .AddTraceSource("Decision", "The rule, inputs and outcome of a sampled rate decision",
+                            MakeTraceSourceAccessor(&UdpClient::m_decisionTrace),
+                            "ns3::UdpCcController::DecisionTracedCallback")
+            .AddTraceSource("Complete", "Every packet has been acknowledged in reliable mode",
+                            MakeTraceSourceAccessor(&UdpClient::m_completeTrace),
+                            "ns3::UdpClient::CompleteTracedCallback")
         ;
         return tid;
     }
@@ -93,17 +205,20 @@ namespace ns3 {
     UdpClient::UdpClient() {
         NS_LOG_FUNCTION(this);
         m_sent = 0;
-        m_socket = 0;
+        m_sentBytes = 0;
+        m_lastTx = Seconds(0);
+        m_retransmissions = 0;
+        m_complete = false;
+        m_capBlocked = 0;
+        m_feedbackTimeouts = 0;
+        m_feedbackDelay = Time(0);
+        m_feedbacks = 0;
+        m_intervalSum = 0;
+        m_intervalSquareSum = 0;
+        m_frameQueueBytes = 0;
+        m_frames = 0;
+        m_skippedFrames = 0;
         m_sendEvent = EventId();
-        m_interval = MicroSeconds(500);
-        m_trendlineSlope = 0;
-        m_delayMin = MilliSeconds(1000);
-        m_delayMax = MilliSeconds(0);
-        m_targetInterval = MilliSeconds(1000);
-        m_delayMinInterval = MicroSeconds(10000);
-        m_delayMaxInterval = MicroSeconds(200);
-        m_totalLost = 0;
-        m_lostTrace = 0;
     }
 
     UdpClient::~UdpClient() {
@@ -121,251 +236,701 @@ namespace ns3 {
         m_peerAddress = addr;
     }
 
+    void UdpClient::AddPath(Address ip) {
+        NS_LOG_FUNCTION(this << ip);
+        NS_ASSERT_MSG(Ipv4Address::IsMatchingType(ip), "Subflows need an IPv4 address: " << ip);
+        m_pathAddresses.push_back(ip);
+    }
+
+    uint32_t UdpClient::GetPathCount(void) const {
+        return m_subflows.size();
+    }
+
+    Ptr<UdpCcController> UdpClient::GetController(uint32_t path) const {
+        NS_ASSERT(path < m_subflows.size());
+        return m_subflows[path].controller;
+    }
+
+    Time UdpClient::GetLastTx(void) const {
+        return m_lastTx;
+    }
+
+    uint32_t UdpClient::GetRetransmissions(void) const {
+        return m_retransmissions;
+    }
+
+    uint32_t UdpClient::GetFrames(void) const {
+        return m_frames;
+    }
+
+    uint32_t UdpClient::GetSkippedFrames(void) const {
+        return m_skippedFrames;
+    }
+
+    uint32_t UdpClient::GetCapBlocked(void) const {
+        return m_capBlocked;
+    }
+
+    uint32_t UdpClient::GetFeedbackTimeouts(void) const {
+        return m_feedbackTimeouts;
+    }
+
+    uint32_t UdpClient::GetAveragePacketSize(void) const {
+        return m_sent > 0 ? m_sentBytes / m_sent : 0;
+    }
+
+    Time UdpClient::GetFeedbackDelay(void) const {
+        return m_feedbacks > 0 ? m_feedbackDelay / m_feedbacks : Time(0);
+    }
+
+    Time UdpClient::GetIntervalDeviation(void) const {
+        if (m_feedbacks == 0) {
+            return Time(0);
+        }
+        double mean = m_intervalSum / m_feedbacks;
+        return Seconds(std::sqrt(std::max(0.0, m_intervalSquareSum / m_feedbacks - mean * mean)));
+    }
+
     void UdpClient::DoDispose(void) {
         NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_sendEvent);
+        Simulator::Cancel(m_frameEvent);
+        ReleaseStateCache();
+
+        // Release the sockets so that short-lived flows can be torn down before the simulation ends
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            Simulator::Cancel(iter->watchdogEvent);
+            iter->socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            iter->socket->Close();
+        }
+        m_subflows.clear();
+        m_stateCache = 0;
         Application::DoDispose();
     }
 
     void UdpClient::StartApplication(void) {
         NS_LOG_FUNCTION(this);
 
-        if (m_socket == 0) {
+        if (m_subflows.empty()) {
             TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
-            m_socket = Socket::CreateSocket(GetNode(), tid);
-            if (Ipv4Address::IsMatchingType(m_peerAddress) == true) {
-                if (m_socket->Bind() == -1) {
+            Subflow subflow;
+
+            // Feedback of every path comes from the server's main address, so path sockets stay unconnected
+            for (std::vector<Address>::iterator iter = m_pathAddresses.begin(); iter != m_pathAddresses.end(); iter++) {
+                subflow.socket = Socket::CreateSocket(GetNode(), tid);
+                subflow.peerAddress = *iter;
+                if (subflow.socket->Bind() == -1) {
                     NS_FATAL_ERROR("Failed to bind socket");
                 }
-                m_socket->Connect(InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), m_peerPort));
-            } else if (Ipv6Address::IsMatchingType(m_peerAddress) == true) {
-                if (m_socket->Bind6() == -1) {
-                    NS_FATAL_ERROR("Failed to bind socket");
+                m_subflows.push_back(subflow);
+            }
+
+            if (m_subflows.empty()) {
+                subflow.socket = Socket::CreateSocket(GetNode(), tid);
+                subflow.peerAddress = m_peerAddress;
+                if (Ipv4Address::IsMatchingType(m_peerAddress) == true) {
+                    if (subflow.socket->Bind() == -1) {
+                        NS_FATAL_ERROR("Failed to bind socket");
+                    }
+                    subflow.socket->Connect(InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), m_peerPort));
+                } else if (Ipv6Address::IsMatchingType(m_peerAddress) == true) {
+                    if (subflow.socket->Bind6() == -1) {
+                        NS_FATAL_ERROR("Failed to bind socket");
+                    }
+                    subflow.socket->Connect(Inet6SocketAddress(Ipv6Address::ConvertFrom(m_peerAddress), m_peerPort));
+                } else if (InetSocketAddress::IsMatchingType(m_peerAddress) == true) {
+                    if (subflow.socket->Bind() == -1) {
+                        NS_FATAL_ERROR("Failed to bind socket");
+                    }
+                    subflow.socket->Connect(m_peerAddress);
+                } else if (Inet6SocketAddress::IsMatchingType(m_peerAddress) == true) {
+                    if (subflow.socket->Bind6() == -1) {
+                        NS_FATAL_ERROR("Failed to bind socket");
+                    }
+                    subflow.socket->Connect(m_peerAddress);
+                } else {
+                    NS_ASSERT_MSG(false, "Incompatible address type: " << m_peerAddress);
                 }
-                m_socket->Connect(Inet6SocketAddress(Ipv6Address::ConvertFrom(m_peerAddress), m_peerPort));
-            } else if (InetSocketAddress::IsMatchingType(m_peerAddress) == true) {
-                if (m_socket->Bind() == -1) {
-                    NS_FATAL_ERROR("Failed to bind socket");
+                m_subflows.push_back(subflow);
+            }
+
+            for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+                iter->controller = CreateObject<UdpCcController>();
+                iter->sent = 0;
+                iter->nextSend = Seconds(0.0);
+                iter->acked = 0;
+                iter->receivedEnd = 0;
+                iter->rtt = MilliSeconds(100); // Until the first feedback
+                iter->lastProgress = Simulator::Now();
+                iter->txBytes = 0;
+                iter->fedBytes = 0;
+                iter->capped = false;
+                iter->capRelease = Simulator::Now();
+                iter->packetSize = m_size;
+                iter->lostReported = 0;
+                iter->lostNominal = 0;
+                iter->lastFeedback = Simulator::Now();
+                iter->cached = false;
+                iter->lastStore = Simulator::Now();
+
+                // A warm start skips the bootstrap ramp, which overshoots on slow paths
+                if (m_stateCache != 0 && Ipv4Address::IsMatchingType(iter->peerAddress)) {
+                    UdpCcState state;
+                    if (m_stateCache->Acquire(Ipv4Address::ConvertFrom(iter->peerAddress), state)) {
+                        iter->controller->SetState(state);
+                    }
+                    iter->cached = true;
                 }
-                m_socket->Connect(m_peerAddress);
-            } else if (Inet6SocketAddress::IsMatchingType(m_peerAddress) == true) {
-                if (m_socket->Bind6() == -1) {
-                    NS_FATAL_ERROR("Failed to bind socket");
+                if (m_adaptiveSize && m_reliable) {
+                    iter->sizeLog.assign(m_bufferSize, 0);
+                }
+                if (m_compactFeedback || m_inFlightCap) {
+                    SentRecord unused;
+                    unused.seq = 0xffffffff;
+                    iter->sentLog.assign(SENT_LOG_SIZE, unused);
                 }
-                m_socket->Connect(m_peerAddress);
-            } else {
-                NS_ASSERT_MSG(false, "Incompatible address type: " << m_peerAddress);
             }
+
+            Ptr<UdpCcController> controller = m_subflows[0].controller;
+            controller->TraceConnectWithoutContext("TrendlineSlope", MakeCallback(&UdpClient::TraceTrendlineSlope, this));
+            controller->TraceConnectWithoutContext("Interval", MakeCallback(&UdpClient::TraceInterval, this));
+            controller->TraceConnectWithoutContext("Lost", MakeCallback(&UdpClient::TraceLost, this));
+            controller->TraceConnectWithoutContext("TargetInterval", MakeCallback(&UdpClient::TraceTargetInterval, this));
+            controller->TraceConnectWithoutContext("Ce", MakeCallback(&UdpClient::TraceCe, this));
+            controller->TraceConnectWithoutContext("Decision", MakeCallback(&UdpClient::TraceDecision, this));
+            UpdateIncreaseWeights();
         }
 
-        m_socket->SetRecvCallback(MakeCallback(&UdpClient::HandleRead, this));
-        m_socket->SetAllowBroadcast(true);
-        m_sendEvent = Simulator::Schedule(Seconds(0.0), &UdpClient::Send, this);
+        // Late frames are dropped rather than repaired, and frames set the size of their packets
+        if (m_frameRate > 0 && (m_reliable || m_adaptiveSize)) {
+            NS_FATAL_ERROR("Frame mode cannot be combined with Reliable or AdaptiveSize");
+        }
+        if (m_adaptiveSize && m_maxSize == 0) {
+            // Path MTU discovery is not modelled, the first hop's MTU stands for the path's
+            m_maxSize = 1472;
+            Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
+            if (ipv4 != 0 && ipv4->GetRoutingProtocol() != 0 && Ipv4Address::IsMatchingType(m_subflows[0].peerAddress)) {
+                Ipv4Header header;
+                header.SetDestination(Ipv4Address::ConvertFrom(m_subflows[0].peerAddress));
+                Socket::SocketErrno error;
+                Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol()->RouteOutput(0, header, 0, error);
+                if (route != 0) {
+                    m_maxSize = route->GetOutputDevice()->GetMtu() - 28;
+                }
+            }
+            m_maxSize = std::max(m_maxSize, m_minSize);
+        }
+
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            iter->socket->SetRecvCallback(MakeCallback(&UdpClient::HandleRead, this));
+            iter->socket->SetAllowBroadcast(true);
+            if (iter->controller->GetEcnCodepoint() != 0) {
+                iter->socket->SetIpTos(iter->controller->GetEcnCodepoint());
+            }
+        }
+        if (m_frameRate > 0) {
+            m_frameEvent = Simulator::Schedule(Seconds(0.0), &UdpClient::GenerateFrame, this);
+        } else {
+            m_sendEvent = Simulator::Schedule(Seconds(0.0), &UdpClient::Send, this);
+        }
     }
 
     void UdpClient::StopApplication(void) {
         NS_LOG_FUNCTION(this);
         Simulator::Cancel(m_sendEvent);
+        Simulator::Cancel(m_frameEvent);
 
-        if (m_socket != 0) {
-            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            Simulator::Cancel(iter->watchdogEvent);
+            iter->socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
         }
     }
 
     void UdpClient::Send(void) {
         NS_LOG_FUNCTION(this);
         NS_ASSERT(m_sendEvent.IsExpired());
-        UdpCcHeader header;
-        header.SetSeq(m_sent);
-        header.SetInterval(m_interval);
-        Ptr<Packet> p = Create<Packet>(m_size - header.GetSerializedSize());
-        p->AddHeader(header);
-
-        std::stringstream peerAddressStringStream;
-        if (Ipv4Address::IsMatchingType(m_peerAddress)) {
-            peerAddressStringStream << Ipv4Address::ConvertFrom(m_peerAddress);
-        } else if (Ipv6Address::IsMatchingType(m_peerAddress)) {
-            peerAddressStringStream << Ipv6Address::ConvertFrom(m_peerAddress);
-        }
-
-        if ((m_socket->Send(p)) >= 0) {
-            ++m_sent;
-            NS_LOG_INFO("TraceDelay TX " << m_size <<
-                        " bytes to " << peerAddressStringStream.str() <<
-                        " Uid: " << p->GetUid() <<
-                        " Time: " <<(Simulator::Now()).GetSeconds());
-        } else {
-            NS_LOG_INFO("Error while sending " << m_size <<
-                        " bytes to " << peerAddressStringStream.str());
-        }
 
-        if (m_sent < m_count) {
-            m_sendEvent = Simulator::Schedule(m_interval, &UdpClient::Send, this);
+        FramePacket frame;
+        if (m_frameRate > 0 && !NextFramePacket(frame)) {
+            return; // Idle until the next frame is captured
         }
-    }
 
-    void UdpClient::HandleRead(Ptr<Socket> socket) {
-        NS_LOG_FUNCTION(this << socket);
-        Ptr<Packet> packet;
-        Address from;
-        Address localAddress;
-        while ((packet = socket->RecvFrom(from))) {
-            message_t msg;
+        // Send on the subflow that is due first
+        uint32_t path = 0;
+        for (uint32_t i = 1; i < m_subflows.size(); i++) {
+            if (m_subflows[i].nextSend < m_subflows[path].nextSend) {
+                path = i;
+            }
+        }
+        Subflow &subflow = m_subflows[path];
+
+        uint32_t seq = subflow.sent;
+        bool fresh = true;
+        uint32_t size = m_size;
+        bool capped = m_inFlightCap && IsCapped(subflow);
+        if (capped) {
+            if (!subflow.capped) {
+                subflow.capped = true;
+                m_capBlocked++;
+            }
+            if (m_frameRate > 0) {
+                m_frameQueue.push_front(frame);
+                m_frameQueueBytes += frame.size;
+            }
+        } else if (!m_reliable || NextReliableSeq(subflow, seq, fresh)) {
+            if (m_adaptiveSize) {
+                // A resent packet keeps the size of the original
+                size = fresh ? AdaptPacketSize(subflow) : subflow.sizeLog[seq % m_bufferSize];
+            }
             UdpCcHeader header;
-            packet->RemoveHeader(header);
-            packet->CopyData(msg.buf, 12);
-            ControlSend(msg.lost, header.GetTs(), Time(msg.recvTime), header.GetInterval());
+            header.SetSeq(seq);
+            header.SetInterval(subflow.controller->GetInterval());
+            header.SetPath(path);
+            Ptr<Packet> p;
+            if (m_frameRate > 0) {
+                size = frame.size; // Paced by its bytes, as GenerateFrame expects the backlog to drain
+                frame_t info;
+                info.captureTime = frame.capture.GetInteger();
+                info.frameId = frame.frameId;
+                info.index = frame.index;
+                info.count = frame.count;
+                p = Create<Packet>(info.buf, 16);
+                p->AddPaddingAtEnd(frame.size - header.GetSerializedSize() - 16);
+            } else {
+                p = Create<Packet>(size - header.GetSerializedSize());
+            }
+            p->AddHeader(header);
 
-            if (InetSocketAddress::IsMatchingType(from)) {
-                NS_LOG_INFO("At time " << Simulator::Now().GetSeconds() << "s client received " << packet->GetSize() <<
-                            " bytes from " <<InetSocketAddress::ConvertFrom(from).GetIpv4() <<
-                            " port " << InetSocketAddress::ConvertFrom(from).GetPort());
-            } else if (Inet6SocketAddress::IsMatchingType(from)) {
-                NS_LOG_INFO("At time " << Simulator::Now().GetSeconds() << "s client received " << packet->GetSize() <<
-                            " bytes from " << Inet6SocketAddress::ConvertFrom(from).GetIpv6() <<
-                            " port " << Inet6SocketAddress::ConvertFrom(from).GetPort());
+            std::stringstream peerAddressStringStream;
+            if (Ipv4Address::IsMatchingType(subflow.peerAddress)) {
+                peerAddressStringStream << Ipv4Address::ConvertFrom(subflow.peerAddress);
+            } else if (Ipv6Address::IsMatchingType(subflow.peerAddress)) {
+                peerAddressStringStream << Ipv6Address::ConvertFrom(subflow.peerAddress);
+            }
+
+            m_txTrace(p);
+            int result;
+            if (m_pathAddresses.empty()) {
+                result = subflow.socket->Send(p);
+            } else {
+                result = subflow.socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(subflow.peerAddress), m_peerPort));
+            }
+
+            if (result >= 0) {
+                m_lastTx = Simulator::Now();
+                subflow.txBytes += p->GetSize();
+                if (fresh) {
+                    ++m_sent;
+                    ++subflow.sent;
+                    m_sentBytes += p->GetSize();
+                    if (m_adaptiveSize && m_reliable) {
+                        subflow.sizeLog[seq % m_bufferSize] = size;
+                    }
+                } else {
+                    ++m_retransmissions;
+                    subflow.retransmitted[seq] = Simulator::Now();
+                }
+                if (m_compactFeedback || m_inFlightCap) {
+                    SentRecord &record = subflow.sentLog[seq % SENT_LOG_SIZE];
+                    record.seq = seq;
+                    record.sendTime = header.GetTs();
+                    record.interval = header.GetInterval();
+                    record.txBytes = subflow.txBytes;
+                }
+                NS_LOG_INFO("TraceDelay TX " << p->GetSize() <<
+                            " bytes to " << peerAddressStringStream.str() <<
+                            " Uid: " << p->GetUid() <<
+                            " Time: " <<(Simulator::Now()).GetSeconds());
+            } else {
+                if (!fresh) {
+                    subflow.retransmit.insert(seq);
+                }
+                NS_LOG_INFO("Error while sending " << p->GetSize() <<
+                            " bytes to " << peerAddressStringStream.str());
             }
         }
-    }
+        // The watchdog runs while the subflow sends, counting from the first packet after an idle period
+        if (m_feedbackWatchdog && !subflow.watchdogEvent.IsRunning()) {
+            subflow.lastFeedback = Simulator::Now();
+            subflow.watchdogEvent = Simulator::Schedule(m_feedbackTimeoutMin, &UdpClient::CheckFeedback, this, path);
+        }
 
-    void UdpClient::UpdateInterval(Time newInterval) {
-        // Change send interval when new interval is within lower & upper bound
-        if (MicroSeconds(200) <= newInterval && newInterval <= MicroSeconds(10000)) {
-            m_interval = SMOOTH(m_interval, newInterval, 9, 1);
+        if (capped) {
+            // Feedback wakes the subflow up (HandleRead), or else the probe two round trips after the last feedback
+            subflow.nextSend = subflow.capRelease + subflow.rtt * 2 + TimeStep(1);
+        } else {
+            // The interval is the time of a packet of m_size at the controller's rate
+            subflow.nextSend = Simulator::Now() + subflow.controller->GetInterval() * size / m_size;
+        }
+
+        // A reliable transfer keeps its pace until the last packet is acknowledged
+        bool more = m_reliable ? !IsComplete() : HasMoreData();
+        if (more && (m_frameRate == 0 || !m_frameQueue.empty())) {
+            Time next = subflow.nextSend;
+            for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+                next = std::min(next, iter->nextSend);
+            }
+            m_sendEvent = Simulator::Schedule(std::max(next - Simulator::Now(), Seconds(0.0)), &UdpClient::Send, this);
         }
     }
 
-    void UdpClient::ControlSend(uint32_t lost, Time sendTime, Time recvTime, Time sendInterval) {
-        m_sendTimeList.push_back(sendTime);
-        m_recvTimeList.push_back(recvTime);
+    Time UdpClient::GetFeedbackTimeout(const Subflow &subflow) const {
+        // The server sends feedback on the first packet UDP_CC_FEEDBACK_PERIOD after the last one, so
+        // feedbacks are a period or an interval apart, whichever is longer, and a few gaps past the round trip is late
+        Time gap = std::max(MilliSeconds(UDP_CC_FEEDBACK_PERIOD), subflow.controller->GetInterval());
+        return std::max(m_feedbackTimeoutMin, subflow.rtt * 2 + gap * 4);
+    }
 
-        // Calculate packet loss
-        m_lostTrace = lost - m_totalLost;
-        m_totalLost = lost;
+    void UdpClient::CheckFeedback(uint32_t path) {
+        NS_LOG_FUNCTION(this << path);
+        if (!m_sendEvent.IsRunning()) {
+            return; // Idle, Send starts the watchdog again
+        }
 
-        // Calculate moving send interval when the packet was sent
-        m_recvIntervalAvg = SMOOTH(m_recvIntervalAvg, sendInterval, 9, 1);
+        Subflow &subflow = m_subflows[path];
+        Time timeout = GetFeedbackTimeout(subflow);
+        if (Simulator::Now() >= subflow.lastFeedback + timeout) {
+            m_feedbackTimeouts++;
+            subflow.controller->OnFeedbackTimeout(m_deadmanBackoff, m_deadmanMaxInterval);
+            subflow.lastFeedback = Simulator::Now(); // The next backoff follows one timeout later
+            timeout = GetFeedbackTimeout(subflow);
+            NS_LOG_INFO("No feedback on path " << path << ", interval " << subflow.controller->GetInterval().GetMicroSeconds() << " us");
+        }
+        subflow.watchdogEvent = Simulator::Schedule(subflow.lastFeedback + timeout - Simulator::Now(),
+                                                    &UdpClient::CheckFeedback, this, path);
+    }
 
-        if (m_sendTimeList.size() >= LIST_SIZE_LOWER_LIMIT) {
-            if (m_sendTimeList.size() > LIST_SIZE_UPPER_LIMIT) {
-                // Adjust(fix) calculation window
-                m_sendTimeList.pop_front();
-                m_recvTimeList.pop_front();
+    void UdpClient::ReleaseStateCache(void) {
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            if (!iter->cached) {
+                continue;
             }
+            Ipv4Address destination = Ipv4Address::ConvertFrom(iter->peerAddress);
+            UdpCcState state;
+            if (iter->controller->GetState(state)) {
+                m_stateCache->Store(destination, state);
+            }
+            m_stateCache->Release(destination);
+            iter->cached = false;
+        }
+    }
 
-            // Calculate trendline slope and current delay(smoothed)
-            std::list<Time>::iterator sendIter = m_sendTimeList.begin();
-            std::list<Time>::iterator recvIter = m_recvTimeList.begin();
-
-            Time prevSendTime(*sendIter), prevRecvTime(*recvIter);
-            sendIter++, recvIter++;
-            Time baseSendTime(*sendIter), baseRecvTime(*recvIter);
+    bool UdpClient::HasMoreData(void) const {
+        // The flow size is the same number of bytes whatever the packet size
+        return m_adaptiveSize ? m_sentBytes < (uint64_t) m_count * m_size : m_sent < m_count;
+    }
 
-            Time smoothedDelay(prevRecvTime - prevSendTime);
-            Time accumulatedDelayDelta(0);
-            Time smoothedDelayDelta(0);
+    uint32_t UdpClient::AdaptPacketSize(Subflow &subflow) {
+        double rate = m_size / subflow.controller->GetInterval().GetSeconds();
+        uint32_t size = std::max<double>(m_minSize, std::min<double>(m_maxSize, rate * m_adaptiveGap.GetSeconds()));
 
-            std::list<Time> x, y;
-            Time xSum(0), ySum(0);
+        // The last packet carries only the rest of the flow
+        uint64_t rest = (uint64_t) m_count * m_size - std::min<uint64_t>(m_sentBytes, (uint64_t) m_count * m_size);
+        size = std::max<uint64_t>(std::min<uint64_t>(size, rest), std::min(m_minSize, m_size));
+        subflow.packetSize = size;
+        return size;
+    }
 
-            for ( ; sendIter != m_sendTimeList.end() && recvIter != m_recvTimeList.end(); sendIter++, recvIter++) {
-                smoothedDelay = SMOOTH(smoothedDelay, *recvIter - *sendIter, 9, 1);
-                accumulatedDelayDelta += ((*recvIter - prevRecvTime) - (*sendIter - prevSendTime));
-                smoothedDelayDelta = SMOOTH(smoothedDelayDelta, accumulatedDelayDelta, 9, 1);
+    bool UdpClient::IsCapped(Subflow &subflow) {
+        if (subflow.minRtt.Get() == Time::Max()) {
+            return false; // No round trip sample yet
+        }
 
-                x.push_back(*recvIter - baseRecvTime);
-                y.push_back(smoothedDelayDelta);
+        // Bandwidth-delay product at the pacing rate, not less than a few packets
+        double rate = m_size / subflow.controller->GetInterval().GetSeconds();
+        double limit = std::max(m_inFlightGain * rate * subflow.minRtt.Get().GetSeconds(), 4.0 * subflow.packetSize);
+        double inFlight = (double) (subflow.txBytes - std::min(subflow.fedBytes, subflow.txBytes));
+        if (inFlight < limit) {
+            subflow.capped = false;
+            return false;
+        }
 
-                xSum += *recvIter - baseRecvTime;
-                ySum += smoothedDelayDelta;
+        // Lost feedback would block forever, so a probe is let through after two round trips without any
+        if (Simulator::Now() - subflow.capRelease > subflow.rtt * 2) {
+            subflow.capRelease = Simulator::Now();
+            return false;
+        }
+        return true;
+    }
 
-                prevSendTime = *sendIter;
-                prevRecvTime = *recvIter;
+    bool UdpClient::NextReliableSeq(Subflow &subflow, uint32_t &seq, bool &fresh) {
+        // Missing packets go before new data
+        while (!subflow.retransmit.empty()) {
+            seq = *subflow.retransmit.begin();
+            subflow.retransmit.erase(subflow.retransmit.begin());
+            if (seq >= subflow.acked) {
+                fresh = false;
+                return true;
             }
+        }
 
-            Time xAvg(xSum / x.size());
-            Time yAvg(ySum / y.size());
-
-            double numerator = 0.0;
-            double denominator = 0.0;
-            std::list<Time>::iterator xIter = x.begin();
-            std::list<Time>::iterator yIter = y.begin();
+        if (HasMoreData() && subflow.sent - subflow.acked < m_bufferSize) {
+            seq = subflow.sent;
+            fresh = true;
+            return true;
+        }
 
-            for (; xIter != x.end() && yIter != y.end(); xIter++, yIter++) {
-                numerator += ((*xIter - xAvg) * (*yIter - yAvg)).GetDouble();
-                denominator += ((*xIter - xAvg) * (*xIter - xAvg)).GetDouble();
+        // NACKs only cover the gaps below the highest received packet, so a lost tail
+        // and the first unacknowledged packet are resent after two round trips without progress
+        if (subflow.acked < subflow.sent && Simulator::Now() - subflow.lastProgress > subflow.rtt * 2) {
+            subflow.lastProgress = Simulator::Now();
+            subflow.retransmit.insert(subflow.acked);
+            for (uint32_t tail = std::max(subflow.acked, subflow.receivedEnd); tail < subflow.sent; tail++) {
+                subflow.retransmit.insert(tail);
             }
-            m_trendlineSlope = numerator / denominator;
+            seq = *subflow.retransmit.begin();
+            subflow.retransmit.erase(subflow.retransmit.begin());
+            fresh = false;
+            return true;
+        }
+        return false;
+    }
+
+    void UdpClient::HandleNacks(Subflow &subflow, const uint8_t *buf, uint32_t size) {
+        if (size < sizeof(nack_header_t)) {
+            return;
+        }
+        nack_header_t nack;
+        memcpy(&nack, buf, sizeof(nack));
 
-            // Calculate delay range and average delay
-            if (m_delayMin >= smoothedDelay) {
-                m_delayMin = smoothedDelay;
+        if (nack.cumAck > subflow.acked || nack.receivedEnd > subflow.receivedEnd) {
+            subflow.lastProgress = Simulator::Now();
+        }
+        if (nack.cumAck > subflow.acked) {
+            subflow.acked = nack.cumAck;
+            subflow.retransmit.erase(subflow.retransmit.begin(), subflow.retransmit.lower_bound(subflow.acked));
+            subflow.retransmitted.erase(subflow.retransmitted.begin(), subflow.retransmitted.lower_bound(subflow.acked));
+        }
+        subflow.receivedEnd = std::max(subflow.receivedEnd, nack.receivedEnd);
+
+        uint32_t count = std::min<uint32_t>(nack.count, (size - sizeof(nack_header_t)) / sizeof(nack_range_t));
+        for (uint32_t i = 0; i < count; i++) {
+            nack_range_t range;
+            memcpy(&range, buf + sizeof(nack_header_t) + i * sizeof(nack_range_t), sizeof(range));
+            for (uint32_t seq = std::max(range.start, subflow.acked); seq < range.start + range.length && seq < subflow.sent; seq++) {
+                // The same gap is reported by every feedback until the resent packet arrives
+                std::map<uint32_t, Time>::iterator resent = subflow.retransmitted.find(seq);
+                if (resent == subflow.retransmitted.end() || Simulator::Now() - resent->second > subflow.rtt) {
+                    subflow.retransmit.insert(seq);
+                }
             }
-            if (m_delayMax <= smoothedDelay) {
-                m_delayMax = smoothedDelay;
+        }
+    }
+
+    bool UdpClient::IsComplete(void) const {
+        if (HasMoreData()) {
+            return false;
+        }
+        for (std::vector<Subflow>::const_iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            if (iter->acked < iter->sent) {
+                return false;
             }
-            Time delayAvg = (m_delayMax + m_delayMin) / 2;
+        }
+        return true;
+    }
 
-            // Calculate interval range and target interval
-            if (smoothedDelay <= m_delayMin * 100 / 97 && m_delayMinInterval > m_recvIntervalAvg) {
-                m_delayMinInterval = SMOOTH(m_delayMinInterval, m_recvIntervalAvg, 95, 5);
+    void UdpClient::GenerateFrame(void) {
+        NS_LOG_FUNCTION(this);
+        m_frameEvent = Simulator::Schedule(Seconds(1.0 / m_frameRate), &UdpClient::GenerateFrame, this);
+        uint32_t frameId = m_frames++;
+
+        // Sending rate of all subflows together, in bytes per second
+        double rate = 0;
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            rate += m_size / iter->controller->GetInterval().GetSeconds();
+        }
+
+        uint32_t minPacketSize = UdpCcHeader().GetSerializedSize() + 16;
+        uint32_t size = std::max<uint32_t>(m_frameSize->GetInteger(), minPacketSize);
+        if (m_scaleFrames) {
+            size = std::max<uint32_t>(std::min<double>(size, rate / m_frameRate), minPacketSize);
+        }
+
+        // A frame that cannot be sent before its deadline behind the backlog is not encoded at all
+        if (Seconds((m_frameQueueBytes + size) / rate) > m_frameDeadline) {
+            m_skippedFrames++;
+            return;
+        }
+
+        uint32_t count = (size + m_size - 1) / m_size;
+        for (uint32_t index = 0; index < count; index++) {
+            FramePacket frame;
+            frame.frameId = frameId;
+            frame.index = index;
+            frame.count = count;
+            frame.capture = Simulator::Now();
+            frame.size = std::max(std::min(m_size, size - index * m_size), minPacketSize);
+            m_frameQueue.push_back(frame);
+            m_frameQueueBytes += frame.size;
+        }
+
+        if (m_sendEvent.IsExpired() && m_sent < m_count) {
+            Time next = m_subflows[0].nextSend;
+            for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+                next = std::min(next, iter->nextSend);
             }
-            if ((smoothedDelay >= m_delayMax * 97 / 100 && m_delayMaxInterval < m_recvIntervalAvg) || m_lostTrace.Get() == 0) {
-                m_delayMaxInterval = SMOOTH(m_delayMaxInterval, m_recvIntervalAvg, 9, 1);
+            m_sendEvent = Simulator::Schedule(std::max(next - Simulator::Now(), Seconds(0.0)), &UdpClient::Send, this);
+        }
+    }
+
+    bool UdpClient::NextFramePacket(FramePacket &frame) {
+        while (!m_frameQueue.empty()) {
+            frame = m_frameQueue.front();
+            m_frameQueue.pop_front();
+            m_frameQueueBytes -= frame.size;
+            if (Simulator::Now() - frame.capture <= m_frameDeadline) {
+                return true;
             }
-            m_targetInterval = (m_delayMaxInterval + m_delayMinInterval) / 2;
+            // Too late for playout, not worth the bandwidth
+            NS_LOG_INFO("Dropping packet " << frame.index << " of late frame " << frame.frameId);
+        }
+        return false;
+    }
 
-            // Loss-based and Delay-based control
-            if (m_lostTrace.Get() > 0) {
-                // Lost packets -> Increase interval = Decrease throughput
-                if (m_lostTrace.Get() > 10) {
-                    UpdateInterval(m_interval * 100 / 70);
-                } else {
-                    UpdateInterval(m_interval * 100 / (100 - 3 * m_lostTrace.Get()));
+    void UdpClient::HandleRead(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        Ptr<Packet> packet;
+        Address from;
+        Address localAddress;
+        while ((packet = socket->RecvFrom(from))) {
+            Subflow *subflow = 0;
+            uint32_t seq, lost, ce;
+            Time sendTime, recvTime, sendInterval;
+            if (m_compactFeedback) {
+                UdpCcFeedbackHeader feedback;
+                packet->RemoveHeader(feedback);
+                seq = feedback.GetSeq();
+                lost = feedback.GetLost();
+                ce = feedback.GetCe();
+                // Feedback of a packet that has left the log carries no usable timing
+                if (feedback.GetPath() < m_subflows.size() &&
+                    m_subflows[feedback.GetPath()].sentLog[seq % SENT_LOG_SIZE].seq == seq) {
+                    subflow = &m_subflows[feedback.GetPath()];
+                    const SentRecord &record = subflow->sentLog[seq % SENT_LOG_SIZE];
+                    sendTime = record.sendTime;
+                    sendInterval = record.interval;
+                    recvTime = sendTime + feedback.GetDelay();
                 }
-            } else if (smoothedDelay <= m_delayMin * 100 / 95) {
-                // Too low congestion -> Decrease interval = Increase throughput
-                UpdateInterval(m_interval * 95 / 100);
-            } else if (smoothedDelay > m_delayMax * 95 / 100) {
-                // Too high congestion -> Increase interval = Decrease throughput
-                UpdateInterval(m_interval * 100 / 85);
             } else {
-                if (smoothedDelay > delayAvg * 100 / 80) {
-                    // Above target delay
-                    // Delay increases -> Increase interval = Decrease throughput
-                    if (m_trendlineSlope > 0.05) {
-                        UpdateInterval(m_interval * 100 / 95);
-                    } else if (m_trendlineSlope >= -0.01) {
-                        UpdateInterval(m_interval * 100 / 97);
-                    }
-                    // Delay decreases -> Decrease interval = Increase throughput
-                    if (m_trendlineSlope < -0.10) {
-                        UpdateInterval(m_interval * 96 / 100);
-                    } else if (m_trendlineSlope < -0.05) {
-                        UpdateInterval(m_interval * 98 / 100);
+                message_t msg;
+                UdpCcHeader header;
+                packet->RemoveHeader(header);
+                packet->CopyData(msg.buf, 16);
+                packet->RemoveAtStart(16);
+                seq = header.GetSeq();
+                lost = msg.lost;
+                ce = msg.ce;
+                sendTime = header.GetTs();
+                recvTime = Time(msg.recvTime);
+                sendInterval = header.GetInterval();
+                if (header.GetPath() < m_subflows.size()) {
+                    subflow = &m_subflows[header.GetPath()];
+                }
+            }
+
+            if (subflow != 0) {
+                if (m_adaptiveSize) {
+                    // The controller reacts to lost packets of m_size, as lost bytes matter rather than lost packets
+                    subflow->lostNominal += (double) (lost - std::min(subflow->lostReported, lost)) * subflow->packetSize / m_size;
+                    subflow->lostReported = std::max(subflow->lostReported, lost);
+                    lost = (uint32_t) subflow->lostNominal;
+                }
+                subflow->controller->OnFeedback(lost, ce, seq, sendTime, recvTime, sendInterval);
+                UpdateIncreaseWeights();
+
+                subflow->rtt = (subflow->rtt * 7 + (Simulator::Now() - sendTime)) / 8;
+                subflow->minRtt.Update(Seconds(10), Simulator::Now(), Simulator::Now() - sendTime);
+                subflow->capRelease = Simulator::Now();
+                subflow->lastFeedback = Simulator::Now();
+                if (m_inFlightCap) {
+                    // Everything sent up to the reported packet has left the path; a packet gone from the log
+                    // leaves the estimate high until a later feedback
+                    const SentRecord &record = subflow->sentLog[seq % SENT_LOG_SIZE];
+                    if (record.seq == seq) {
+                        subflow->fedBytes = std::max(subflow->fedBytes, record.txBytes);
                     }
-                } else if (smoothedDelay < delayAvg * 80 / 100) {
-                    // Below target delay
-                    // Delay increases -> Increase interval = Decrease throughput
-                    if (m_trendlineSlope > 0.10) {
-                        UpdateInterval(m_interval * 100 / 95);
-                    } else if (m_trendlineSlope > 0.05) {
-                        UpdateInterval(m_interval * 100 / 97);
+                    // A blocked subflow tries again now rather than at its next pacing slot
+                    if (subflow->capped && m_sendEvent.IsRunning()) {
+                        subflow->nextSend = Simulator::Now();
+                        Simulator::Cancel(m_sendEvent);
+                        m_sendEvent = Simulator::Schedule(Seconds(0.0), &UdpClient::Send, this);
                     }
-                    // Delay decreases -> Decrease interval = Increase throughput
-                    if (m_trendlineSlope < -0.05) {
-                        UpdateInterval(m_interval * 96 / 100);
-                    } else if (m_trendlineSlope <= 0.01) {
-                        UpdateInterval(m_interval * 98 / 100);
+                }
+
+                UdpCcState state;
+                if (subflow->cached && Simulator::Now() - subflow->lastStore >= MilliSeconds(STATE_STORE_PERIOD) &&
+                    subflow->controller->GetState(state)) {
+                    m_stateCache->Store(Ipv4Address::ConvertFrom(subflow->peerAddress), state);
+                    subflow->lastStore = Simulator::Now();
+                }
+
+                // Return path delay and the oscillation of the rate it causes
+                double interval = m_subflows[0].controller->GetInterval().GetSeconds();
+                m_feedbackDelay += Simulator::Now() - recvTime;
+                m_feedbacks++;
+                m_intervalSum += interval;
+                m_intervalSquareSum += interval * interval;
+
+                if (m_reliable && packet->GetSize() > 0) {
+                    std::vector<uint8_t> buf(packet->GetSize());
+                    packet->CopyData(&buf[0], buf.size());
+                    HandleNacks(*subflow, &buf[0], buf.size());
+                    if (!m_complete && IsComplete()) {
+                        m_complete = true;
+                        m_completeTrace(m_retransmissions);
                     }
-                } else {
-                    // Within target delay -> Hold interval = Hold throughput
-                    UpdateInterval(SMOOTH(m_interval, ((m_delayMaxInterval + m_delayMinInterval) / 2) * 100 / 97, 5, 5));
                 }
             }
-        } else {
-            // Bootstrap stage -> Decrease interval = Increase throughput
-            UpdateInterval(m_interval * 75 / 100);
+
+            if (InetSocketAddress::IsMatchingType(from)) {
+                NS_LOG_INFO("At time " << Simulator::Now().GetSeconds() << "s client received " << packet->GetSize() <<
+                            " bytes from " <<InetSocketAddress::ConvertFrom(from).GetIpv4() <<
+                            " port " << InetSocketAddress::ConvertFrom(from).GetPort());
+            } else if (Inet6SocketAddress::IsMatchingType(from)) {
+                NS_LOG_INFO("At time " << Simulator::Now().GetSeconds() << "s client received " << packet->GetSize() <<
+                            " bytes from " << Inet6SocketAddress::ConvertFrom(from).GetIpv6() <<
+                            " port " << Inet6SocketAddress::ConvertFrom(from).GetPort());
+            }
+        }
+    }
+
+    void UdpClient::UpdateIncreaseWeights(void) {
+        if (!m_coupled || m_subflows.size() < 2) {
+            return;
+        }
+
+        // Each subflow takes the share of a rate increase that its rate has of the total rate
+        double totalRate = 0;
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            totalRate += 1.0 / iter->controller->GetInterval().GetSeconds();
+        }
+        for (std::vector<Subflow>::iterator iter = m_subflows.begin(); iter != m_subflows.end(); iter++) {
+            iter->controller->SetIncreaseWeight(1.0 / iter->controller->GetInterval().GetSeconds() / totalRate);
         }
     }
 
+    void UdpClient::TraceTrendlineSlope(double oldValue, double newValue) {
+        m_trendlineSlopeTrace(oldValue, newValue);
+    }
+
+    void UdpClient::TraceInterval(Time oldValue, Time newValue) {
+        m_intervalTrace(oldValue, newValue);
+    }
+
+    void UdpClient::TraceLost(uint32_t oldValue, uint32_t newValue) {
+        m_lostTrace(oldValue, newValue);
+    }
+
+    void UdpClient::TraceTargetInterval(Time oldValue, Time newValue) {
+        m_targetIntervalTrace(oldValue, newValue);
+    }
+
+    void UdpClient::TraceCe(uint32_t oldValue, uint32_t newValue) {
+        m_ceTrace(oldValue, newValue);
+    }
+
+    void UdpClient::TraceDecision(const UdpCcDecision &decision) {
+        m_decisionTrace(decision);
+    }
+
 } // Namespace ns3
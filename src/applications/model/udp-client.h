@@ -27,13 +27,14 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
-#include "ns3/traced-value.h"
 #include "ns3/traced-callback.h"
+#include "ns3/udp-cc-controller.h"
+#include "ns3/random-variable-stream.h"
 
-#include <list>
-
-#define LIST_SIZE_LOWER_LIMIT 5
-#define LIST_SIZE_UPPER_LIMIT 30
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace ns3 {
 
@@ -46,6 +47,38 @@ namespace ns3 {
      * \brief A Udp client. Sends UDP packet carrying sequence number and time stamp
      *  in their payloads
      *
+     * The client may spread its packets over several paths (subflows) to the
+     * same server. Each subflow has its own socket and rate controller, and a
+     * scheduler sends every packet on the subflow that is due first.
+     *
+     * In reliable mode the client keeps the unacknowledged packets of each
+     * subflow in a bounded window and resends the ranges the server reports
+     * missing, ahead of new data but at the same paced rate.
+     *
+     * With compact feedback the server reports only the sequence number, path,
+     * one-way delay and counters of a packet, and the client takes the send
+     * time and interval from a log of its recently sent packets.
+     *
+     * An optional in-flight cap stops a subflow from sending while more than a
+     * multiple of its bandwidth-delay product (pacing rate times minimum round
+     * trip time) is unacknowledged by feedback, so that the queue stops growing
+     * when feedback is late. A blocked subflow waits for feedback rather than
+     * polling at its pacing rate.
+     *
+     * With adaptive packet size the controller's interval is read as a rate
+     * in packets of PacketSize, and the client sends that rate with packets
+     * sized to be AdaptiveGap apart, between MinPacketSize and the MTU. Fast
+     * flows send fewer, larger packets and slow flows send more often. The
+     * flow size stays MaxPackets times PacketSize bytes, and losses are fed
+     * to the controller in packets of PacketSize.
+     *
+     * In frame mode the client models a real-time video source: frames of
+     * random size are captured at a fixed frame rate, split into packets and
+     * paced by the controllers. Frames are scaled down to the per-frame budget
+     * of the current rate, skipped when the backlog would make them miss the
+     * playout deadline, and packets still queued past the deadline are dropped.
+     * Each packet is paced by its own size. Frame mode excludes Reliable and
+     * AdaptiveSize.
      */
     class UdpClient : public Application {
     public:
@@ -71,6 +104,85 @@ namespace ns3 {
          */
         void SetRemote(Address addr);
 
+        /**
+         * \brief Add a subflow towards an address of the server routed over its own path
+         *
+         * Once paths are added, the client sends only over them instead of the
+         * remote address. Every subflow uses the remote port.
+         *
+         * \param ip alternative IP address of the server
+         */
+        void AddPath(Address ip);
+
+        /**
+         * \return the number of subflows, one per path address (one to the remote address when no path is added)
+         */
+        uint32_t GetPathCount(void) const;
+
+        /**
+         * \param path the subflow index
+         * \return the rate controller of the subflow
+         */
+        Ptr<UdpCcController> GetController(uint32_t path) const;
+
+        /**
+         * \return true while the flow has new data to send
+         */
+        bool HasMoreData(void) const;
+
+        /**
+         * \return the time of the last sent packet, retransmissions included
+         */
+        Time GetLastTx(void) const;
+
+        /**
+         * \return the number of retransmitted packets (reliable mode)
+         */
+        uint32_t GetRetransmissions(void) const;
+
+        /**
+         * \return the number of frames captured (frame mode)
+         */
+        uint32_t GetFrames(void) const;
+
+        /**
+         * \return the number of frames skipped before sending (frame mode)
+         */
+        uint32_t GetSkippedFrames(void) const;
+
+        /**
+         * \return the number of times a subflow was blocked by the in-flight cap
+         */
+        uint32_t GetCapBlocked(void) const;
+
+        /**
+         * \return the number of rate backoffs for missing feedback
+         */
+        uint32_t GetFeedbackTimeouts(void) const;
+
+        /**
+         * \return the average size of the sent packets, not counting retransmissions
+         */
+        uint32_t GetAveragePacketSize(void) const;
+
+        /**
+         * \return the average delay of the feedback from the server to the client
+         */
+        Time GetFeedbackDelay(void) const;
+
+        /**
+         * \return the standard deviation of the send interval of the first subflow,
+         *         sampled at every feedback
+         */
+        Time GetIntervalDeviation(void) const;
+
+        /**
+         * TracedCallback signature for the completion of a reliable transfer.
+         *
+         * \param [in] retransmissions the number of retransmitted packets
+         */
+        typedef void (* CompleteTracedCallback)(uint32_t retransmissions);
+
         /**
          * \brief Handle a packet reception.
          *
@@ -87,36 +199,190 @@ namespace ns3 {
         virtual void StartApplication(void);
         virtual void StopApplication(void);
 
+        /// Send time and interval of a packet, looked up when its compact feedback arrives
+        struct SentRecord {
+            uint32_t seq;
+            Time sendTime;
+            Time interval;
+            uint64_t txBytes; //!< Bytes sent on the subflow up to this packet (in-flight cap)
+        };
+
+        /// Socket, controller and schedule of one path
+        struct Subflow {
+            Subflow() : minRtt(false, Time::Max()) {}
+
+            Ptr<Socket> socket;
+            Ptr<UdpCcController> controller;
+            Address peerAddress;
+            uint32_t sent;
+            Time nextSend;
+            uint32_t acked; //!< All packets below have been delivered
+            uint32_t receivedEnd; //!< One past the highest sequence number the server has seen
+            std::set<uint32_t> retransmit; //!< Missing packets waiting to be resent
+            std::map<uint32_t, Time> retransmitted; //!< Last resend time of the unacknowledged resent packets
+            Time rtt;
+            WindowedFilter minRtt; //!< Lowest round trip time within the last 10 s
+            Time lastProgress;
+            uint64_t txBytes; //!< Bytes sent, resent packets included
+            uint64_t fedBytes; //!< Bytes sent up to the latest packet reported by feedback
+            bool capped; //!< Blocked by the in-flight cap, feedback resumes sending
+            Time capRelease; //!< Last feedback or probe, the in-flight cap gives way after two round trips without one
+            std::vector<SentRecord> sentLog; //!< Recently sent packets, indexed by sequence number (compact feedback, in-flight cap)
+            uint32_t packetSize; //!< Size of the packets sent now
+            std::vector<uint16_t> sizeLog; //!< Size of the unacknowledged packets, indexed by sequence number (reliable adaptive size)
+            uint32_t lostReported; //!< Cumulative lost packets reported by the server
+            double lostNominal; //!< The reported losses in packets of PacketSize (adaptive size)
+            Time lastFeedback; //!< Last feedback, or last backoff of the feedback watchdog
+            EventId watchdogEvent;
+            bool cached; //!< Registered with the state cache
+            Time lastStore; //!< Last state stored in the state cache
+        };
+
+        /// Packet of a captured frame waiting to be sent
+        struct FramePacket {
+            uint32_t frameId;
+            uint16_t index;
+            uint16_t count;
+            Time capture;
+            uint32_t size;
+        };
+
         /**
          * \brief Send a packet
          */
         void Send(void);
 
-        void ControlSend(uint32_t lost, Time sendTime, Time recvTime, Time sendInterval);
-        void UpdateInterval(Time newInterval);
+        /**
+         * \brief Size the next new packet of a subflow to the rate of its controller
+         * \param subflow the subflow
+         * \return the packet size
+         */
+        uint32_t AdaptPacketSize(Subflow &subflow);
+
+        /**
+         * \brief Couple the rate increases of the subflows by their share of the total rate
+         */
+        void UpdateIncreaseWeights(void);
+
+        /**
+         * \param subflow the subflow
+         * \return true if the subflow has a bandwidth-delay product worth of bytes in flight, unless a probe is due
+         */
+        bool IsCapped(Subflow &subflow);
+
+        /**
+         * \param subflow the subflow
+         * \return the time without feedback after which the feedback of the subflow is overdue
+         */
+        Time GetFeedbackTimeout(const Subflow &subflow) const;
+
+        /**
+         * \brief Back off the rate of a subflow whose feedback is overdue, then check again one timeout later
+         * \param path the subflow index
+         */
+        void CheckFeedback(uint32_t path);
+
+        /**
+         * \brief Store the last state of every subflow and unregister them from the state cache
+         */
+        void ReleaseStateCache(void);
+
+        /**
+         * \brief Pick the sequence number to send next on a subflow in reliable mode
+         * \param subflow the subflow
+         * \param seq the sequence number to send
+         * \param fresh set to true for new data, false for a retransmission
+         * \return false if the subflow has nothing to send now
+         */
+        bool NextReliableSeq(Subflow &subflow, uint32_t &seq, bool &fresh);
+
+        /**
+         * \brief Process the cumulative ack and missing ranges of a feedback
+         * \param subflow the subflow the feedback belongs to
+         * \param buf the NACK block
+         * \param size the size of the NACK block
+         */
+        void HandleNacks(Subflow &subflow, const uint8_t *buf, uint32_t size);
+
+        /**
+         * \return true once every packet of every subflow has been acknowledged
+         */
+        bool IsComplete(void) const;
+
+        /**
+         * \brief Capture a frame, then scale, skip or queue it for sending
+         */
+        void GenerateFrame(void);
+
+        /**
+         * \brief Take the next packet of the frame queue, dropping packets past their deadline
+         * \param frame the packet to send
+         * \return false if the queue is empty
+         */
+        bool NextFramePacket(FramePacket &frame);
+
+        // Trace forwarding of the first subflow's controller
+        void TraceTrendlineSlope(double oldValue, double newValue);
+        void TraceInterval(Time oldValue, Time newValue);
+        void TraceLost(uint32_t oldValue, uint32_t newValue);
+        void TraceTargetInterval(Time oldValue, Time newValue);
+        void TraceCe(uint32_t oldValue, uint32_t newValue);
+        void TraceDecision(const UdpCcDecision &decision);
 
         uint32_t m_count; //!< Maximum number of packets the application will send
-        TracedValue<Time> m_interval; //!< Packet inter-send time
         uint32_t m_size; //!< Size of the sent packet(including the SeqTsHeader)
+        bool m_adaptiveSize; //!< Size packets to the rate, m_size is the unit of the controller's rate
+        uint32_t m_minSize; //!< Smallest adaptive packet
+        uint32_t m_maxSize; //!< Largest adaptive packet, 0 for the MTU of the outgoing device
+        Time m_adaptiveGap; //!< Time between packets the adaptive size aims at
+        bool m_coupled; //!< Couple the rate increases of the subflows
+        bool m_reliable; //!< Retransmit the packets reported missing by the server
+        uint32_t m_bufferSize; //!< Maximum number of unacknowledged packets per subflow
+        uint32_t m_retransmissions; //!< Counter for retransmitted packets
+        bool m_complete;
+        bool m_compactFeedback; //!< The server sends the compact feedback header
+        bool m_inFlightCap; //!< Block sending while the estimated bandwidth-delay product is in flight
+        double m_inFlightGain; //!< In-flight limit as a multiple of the bandwidth-delay product
+        uint32_t m_capBlocked; //!< Counter for the times a subflow was blocked by the in-flight cap
+        bool m_feedbackWatchdog; //!< Back off the rate while feedback is missing
+        Time m_feedbackTimeoutMin; //!< Shortest time without feedback before a backoff
+        double m_deadmanBackoff; //!< Interval factor per timeout
+        Time m_deadmanMaxInterval; //!< Largest interval of the backoff
+        uint32_t m_feedbackTimeouts; //!< Counter for backoffs
+        Ptr<UdpCcStateCache> m_stateCache; //!< Warm-start states per destination, shared with other clients
+
+        Time m_feedbackDelay; //!< Sum of the feedback delays
+        uint32_t m_feedbacks;
+        double m_intervalSum; //!< Sum of the sampled send intervals in seconds
+        double m_intervalSquareSum;
+
+        uint32_t m_frameRate; //!< Frames per second, 0 to send packets back to back
+        Ptr<RandomVariableStream> m_frameSize; //!< Frame size in bytes
+        Time m_frameDeadline; //!< Playout deadline of a frame after its capture
+        bool m_scaleFrames; //!< Scale frames down to the per-frame budget of the current rate
+        EventId m_frameEvent;
+        std::deque<FramePacket> m_frameQueue;
+        uint64_t m_frameQueueBytes;
+        uint32_t m_frames;
+        uint32_t m_skippedFrames;
 
         uint32_t m_sent; //!< Counter for sent packets
-        Ptr<Socket> m_socket; //!< Socket
+        uint64_t m_sentBytes; //!< Bytes of the sent packets, not counting retransmissions
+        Time m_lastTx; //!< Time of the last sent packet
         Address m_peerAddress; //!< Remote peer address
         uint16_t m_peerPort; //!< Remote peer port
         EventId m_sendEvent; //!< Event to send the next packet
+        std::vector<Address> m_pathAddresses; //!< Alternative addresses of the server
+        std::vector<Subflow> m_subflows;
 
-        std::list<Time> m_sendTimeList;
-        std::list<Time> m_recvTimeList;
-
-        TracedValue<double> m_trendlineSlope;
-        TracedValue<Time> m_recvIntervalAvg;
-        Time m_delayMin;
-        Time m_delayMax;
-        Time m_delayMinInterval;
-        Time m_delayMaxInterval;
-        TracedValue<Time> m_targetInterval;
-        uint32_t m_totalLost;
-        TracedValue<uint32_t> m_lostTrace;
+        TracedCallback<double, double> m_trendlineSlopeTrace;
+        TracedCallback<Time, Time> m_intervalTrace;
+        TracedCallback<uint32_t, uint32_t> m_lostTrace;
+        TracedCallback<Time, Time> m_targetIntervalTrace;
+        TracedCallback<uint32_t, uint32_t> m_ceTrace;
+        TracedCallback<const UdpCcDecision &> m_decisionTrace;
+        TracedCallback<Ptr<const Packet> > m_txTrace;
+        TracedCallback<uint32_t> m_completeTrace;
     };
 
 } // namespace ns3
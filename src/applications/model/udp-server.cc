@@ -21,6 +21,8 @@
 
 #include "ns3/log.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv6.h"
 #include "ns3/nstime.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/inet6-socket-address.h"
@@ -29,17 +31,30 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/udp-cc-header.h"
 #include "packet-loss-counter.h"
 #include "udp-server.h"
+#include <algorithm>
+#include <cmath>
 
-typedef union {
-    uint8_t buf[12];
-    struct {
-        int64_t recvTime;
-        uint32_t lost;
-    };
-} message_t;
+#define ECN_CE 0x03
+
+// Delay histogram of 2% wide bins from 1 us to about 10 s
+#define DELAY_BIN_GROWTH 1.02
+#define DELAY_BINS 815
+
+// Sender address, port and path of the multiplexed receive state
+#define SOURCE_PATH(key) ((key) & 0xff)
+
+static uint64_t SourceKey(const ns3::Address &from, uint8_t path) {
+    ns3::InetSocketAddress address = ns3::InetSocketAddress::ConvertFrom(from);
+    return ((uint64_t) address.GetIpv4().Get() << 24) | ((uint64_t) address.GetPort() << 8) | path;
+}
+
+static uint32_t SourceHash(uint64_t key) {
+    return (key * 0x9e3779b97f4a7c15ULL) >> 32; // Fibonacci hashing
+}
 
 namespace ns3 {
 
@@ -62,6 +77,46 @@ namespace ns3 {
                           MakeUintegerAccessor(&UdpServer::GetPacketWindowSize,
                                                &UdpServer::SetPacketWindowSize),
                           MakeUintegerChecker<uint16_t>(8,256))
+            .AddAttribute("Reliable",
+                          "Track the delivered packets and report the missing ranges (NACKs) in the feedback",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpServer::m_reliable),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxNackRanges",
+                          "The maximum number of missing ranges reported in one feedback",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&UdpServer::m_maxNackRanges),
+                          MakeUintegerChecker<uint32_t>(1,128))
+            .AddAttribute("Multiplex",
+                          "Keep the loss, delay and feedback state per sender address and port, so that many senders can share the port",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpServer::m_multiplex),
+                          MakeBooleanChecker())
+            .AddAttribute("DelayHistogram",
+                          "Count the packet delays in logarithmic bins to report delay percentiles",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpServer::m_delayHistogram),
+                          MakeBooleanChecker())
+            .AddAttribute("CompactFeedback",
+                          "Send only the fields the sender's controller uses instead of echoing the data header",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpServer::m_compactFeedback),
+                          MakeBooleanChecker())
+            .AddAttribute("FeedbackTos",
+                          "The TOS of the feedback packets, 0x10 (low delay) maps to priority band 0 of PfifoFast",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&UdpServer::m_feedbackTos),
+                          MakeUintegerChecker<uint8_t>())
+            .AddAttribute("FrameDeadline",
+                          "The playout deadline of a frame after its capture, zero when packets carry no frames",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&UdpServer::m_frameDeadline),
+                          MakeTimeChecker())
+            .AddAttribute("StallThreshold",
+                          "The gap between the capture times of two frames played on time that is counted as a stall",
+                          TimeValue(MilliSeconds(200)),
+                          MakeTimeAccessor(&UdpServer::m_stallThreshold),
+                          MakeTimeChecker())
             .AddTraceSource("Rx", "A packet has been received",
                             MakeTraceSourceAccessor(&UdpServer::m_rxTrace),
                             "ns3::Packet::TracedCallback")
@@ -75,13 +130,38 @@ namespace ns3 {
         return tid;
     }
 
-    UdpServer::UdpServer() : m_lossCounter(0) {
+    UdpServer::PathState::PathState() : lossCounter(0) {
+        received = 0;
+        totalRx = 0;
+        totalDelay = Time(0);
+        ce = 0;
+        lastFeedback = Time(0);
+        nextExpected = 0;
+        receivedEnd = 0;
+        delivered = 0;
+        lastDelivery = Time(0);
+    }
+
+    UdpServer::UdpServer() {
         NS_LOG_FUNCTION(this);
         m_received = 0;
         m_totalRx = 0;
-        m_lastFeedback = Time(0);
+        m_packetWindowSize = 32;
+        m_reliable = false;
+        m_maxNackRanges = 16;
+        m_compactFeedback = false;
+        m_multiplex = false;
+        m_delayHistogram = false;
+        m_feedbackTos = 0;
+        m_frameFloor = 0;
+        m_frames = 0;
+        m_framesOnTime = 0;
+        m_lastPlayed = Time(0);
+        m_stalls = 0;
+        m_stallTime = Time(0);
         m_totalDelay = Time(0);
         m_totalDelayCount = 0;
+        m_ce = 0;
    }
 
     UdpServer::~UdpServer() {
@@ -95,17 +175,30 @@ namespace ns3 {
 
     uint16_t UdpServer::GetPacketWindowSize() const {
         NS_LOG_FUNCTION(this);
-        return m_lossCounter.GetBitMapSize();
+        return m_packetWindowSize;
     }
 
     void UdpServer::SetPacketWindowSize(uint16_t size) {
         NS_LOG_FUNCTION(this << size);
-        m_lossCounter.SetBitMapSize(size);
+        m_packetWindowSize = size;
+        for (std::map<uint8_t, PathState>::iterator iter = m_paths.begin(); iter != m_paths.end(); iter++) {
+            iter->second.lossCounter.SetBitMapSize(size);
+        }
+        for (std::deque<PathState>::iterator iter = m_sources.begin(); iter != m_sources.end(); iter++) {
+            iter->lossCounter.SetBitMapSize(size);
+        }
     }
 
     uint32_t UdpServer::GetLost(void) const {
         NS_LOG_FUNCTION(this);
-        return m_lossCounter.GetLost();
+        uint32_t lost = 0;
+        for (std::map<uint8_t, PathState>::const_iterator iter = m_paths.begin(); iter != m_paths.end(); iter++) {
+            lost += iter->second.lossCounter.GetLost();
+        }
+        for (std::deque<PathState>::const_iterator iter = m_sources.begin(); iter != m_sources.end(); iter++) {
+            lost += iter->lossCounter.GetLost();
+        }
+        return lost;
     }
 
     uint64_t UdpServer::GetReceived(void) const {
@@ -113,19 +206,331 @@ namespace ns3 {
         return m_received;
     }
 
+    uint32_t UdpServer::GetCe(void) const {
+        NS_LOG_FUNCTION(this);
+        return m_ce;
+    }
+
+    uint32_t UdpServer::GetPathCount(void) const {
+        return m_paths.size();
+    }
+
+    uint64_t UdpServer::GetPathTotalRx(uint8_t path) const {
+        std::map<uint8_t, PathState>::const_iterator iter = m_paths.find(path);
+        return iter != m_paths.end() ? iter->second.totalRx : 0;
+    }
+
+    uint32_t UdpServer::GetPathLost(uint8_t path) const {
+        std::map<uint8_t, PathState>::const_iterator iter = m_paths.find(path);
+        return iter != m_paths.end() ? iter->second.lossCounter.GetLost() : 0;
+    }
+
+    Time UdpServer::GetPathDelayAvg(uint8_t path) const {
+        std::map<uint8_t, PathState>::const_iterator iter = m_paths.find(path);
+        if (iter == m_paths.end() || iter->second.received == 0) {
+            return Time(0);
+        }
+        return iter->second.totalDelay / iter->second.received;
+    }
+
+    uint64_t UdpServer::GetDelivered(void) const {
+        uint64_t delivered = 0;
+        for (std::map<uint8_t, PathState>::const_iterator iter = m_paths.begin(); iter != m_paths.end(); iter++) {
+            delivered += iter->second.delivered;
+        }
+        for (std::deque<PathState>::const_iterator iter = m_sources.begin(); iter != m_sources.end(); iter++) {
+            delivered += iter->delivered;
+        }
+        return delivered;
+    }
+
+    Time UdpServer::GetLastDelivery(void) const {
+        Time lastDelivery(0);
+        for (std::map<uint8_t, PathState>::const_iterator iter = m_paths.begin(); iter != m_paths.end(); iter++) {
+            lastDelivery = std::max(lastDelivery, iter->second.lastDelivery);
+        }
+        for (std::deque<PathState>::const_iterator iter = m_sources.begin(); iter != m_sources.end(); iter++) {
+            lastDelivery = std::max(lastDelivery, iter->lastDelivery);
+        }
+        return lastDelivery;
+    }
+
+    uint32_t UdpServer::GetSourceCount(void) const {
+        // Paths of a sender are separate entries, count the senders once
+        uint32_t count = 0;
+        for (std::vector<uint64_t>::const_iterator iter = m_sourceKeys.begin(); iter != m_sourceKeys.end(); iter++) {
+            if (SOURCE_PATH(*iter) == 0) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    uint64_t UdpServer::GetSourceTotalRx(const Address &from) const {
+        uint64_t totalRx = 0;
+        for (uint32_t path = 0; path < 256; path++) {
+            int32_t index = FindSource(SourceKey(from, path));
+            if (index < 0) {
+                break;
+            }
+            totalRx += m_sources[index].totalRx;
+        }
+        return totalRx;
+    }
+
+    uint32_t UdpServer::GetSourceLost(const Address &from) const {
+        uint32_t lost = 0;
+        for (uint32_t path = 0; path < 256; path++) {
+            int32_t index = FindSource(SourceKey(from, path));
+            if (index < 0) {
+                break;
+            }
+            lost += m_sources[index].lossCounter.GetLost();
+        }
+        return lost;
+    }
+
+    Time UdpServer::GetSourceDelayAvg(const Address &from) const {
+        Time totalDelay(0);
+        uint64_t received = 0;
+        for (uint32_t path = 0; path < 256; path++) {
+            int32_t index = FindSource(SourceKey(from, path));
+            if (index < 0) {
+                break;
+            }
+            totalDelay += m_sources[index].totalDelay;
+            received += m_sources[index].received;
+        }
+        return received > 0 ? totalDelay / received : Time(0);
+    }
+
+    uint32_t UdpServer::GetFrames(void) const {
+        return m_frames;
+    }
+
+    uint32_t UdpServer::GetFramesOnTime(void) const {
+        return m_framesOnTime;
+    }
+
+    uint32_t UdpServer::GetFramesLate(void) const {
+        return m_frameLatencies.size() - m_framesOnTime;
+    }
+
+    Time UdpServer::GetFrameLatency(double percentile) const {
+        if (m_frameLatencies.empty()) {
+            return Time(0);
+        }
+        std::vector<Time> latencies(m_frameLatencies);
+        uint32_t index = std::min<uint32_t>(latencies.size() - 1, percentile / 100 * latencies.size());
+        std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+        return latencies[index];
+    }
+
+    uint32_t UdpServer::GetStalls(void) const {
+        return m_stalls;
+    }
+
+    Time UdpServer::GetStallTime(void) const {
+        return m_stallTime;
+    }
+
+    UdpServer::PathState &UdpServer::GetPathState(uint8_t path) {
+        std::map<uint8_t, PathState>::iterator iter = m_paths.find(path);
+        if (iter != m_paths.end()) {
+            return iter->second;
+        }
+
+        // Constructed in place, the loss counter owns its bitmap and must not be copied
+        PathState &state = m_paths[path];
+        state.lossCounter.SetBitMapSize(m_packetWindowSize);
+        return state;
+    }
+
+    int32_t UdpServer::FindSource(uint64_t key) const {
+        if (m_sourceTable.empty()) {
+            return -1;
+        }
+        uint32_t mask = m_sourceTable.size() - 1;
+        for (uint32_t slot = SourceHash(key) & mask; m_sourceTable[slot] != 0; slot = (slot + 1) & mask) {
+            if (m_sourceKeys[m_sourceTable[slot] - 1] == key) {
+                return m_sourceTable[slot] - 1;
+            }
+        }
+        return -1;
+    }
+
+    UdpServer::PathState &UdpServer::GetSourceState(const Address &from, uint8_t path) {
+        uint64_t key = SourceKey(from, path);
+        int32_t index = FindSource(key);
+        if (index >= 0) {
+            return m_sources[index];
+        }
+
+        // Grow at half load, linear probing stays short
+        if ((m_sources.size() + 1) * 2 > m_sourceTable.size()) {
+            m_sourceTable.assign(std::max<size_t>(64, m_sourceTable.size() * 2), 0);
+            uint32_t mask = m_sourceTable.size() - 1;
+            for (uint32_t i = 0; i < m_sourceKeys.size(); i++) {
+                uint32_t slot = SourceHash(m_sourceKeys[i]) & mask;
+                while (m_sourceTable[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                m_sourceTable[slot] = i + 1;
+            }
+        }
+
+        uint32_t mask = m_sourceTable.size() - 1;
+        uint32_t slot = SourceHash(key) & mask;
+        while (m_sourceTable[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_sourceKeys.push_back(key);
+        m_sourceTable[slot] = m_sourceKeys.size();
+
+        // Constructed in place, the loss counter owns its bitmap and must not be copied
+        m_sources.emplace_back();
+        PathState &state = m_sources.back();
+        state.lossCounter.SetBitMapSize(m_packetWindowSize);
+        return state;
+    }
+
+    void UdpServer::NotifyDelivered(PathState &path, uint32_t seq, uint32_t size) {
+        // Kept aside, as only reliable servers need it and path states are never relocated
+        std::set<uint32_t> &outOfOrder = m_outOfOrder[&path];
+        if (seq < path.nextExpected || !outOfOrder.insert(seq).second) {
+            return; // Duplicate of a retransmitted packet
+        }
+        path.delivered += size;
+        path.lastDelivery = Simulator::Now();
+        path.receivedEnd = std::max(path.receivedEnd, seq + 1);
+
+        // Slide the cumulative ack over the packets now in order
+        while (!outOfOrder.empty() && *outOfOrder.begin() == path.nextExpected) {
+            outOfOrder.erase(outOfOrder.begin());
+            path.nextExpected++;
+        }
+    }
+
+    void UdpServer::WriteNacks(const PathState &path, std::vector<uint8_t> &buf) const {
+        std::vector<nack_range_t> ranges;
+        uint32_t start = path.nextExpected;
+        std::map<const PathState *, std::set<uint32_t> >::const_iterator outOfOrder = m_outOfOrder.find(&path);
+        if (outOfOrder != m_outOfOrder.end()) {
+            for (std::set<uint32_t>::const_iterator iter = outOfOrder->second.begin();
+                 iter != outOfOrder->second.end() && ranges.size() < m_maxNackRanges; iter++) {
+                if (*iter > start) {
+                    nack_range_t range;
+                    range.start = start;
+                    range.length = *iter - start;
+                    ranges.push_back(range);
+                }
+                start = *iter + 1;
+            }
+        }
+
+        nack_header_t nack;
+        nack.cumAck = path.nextExpected;
+        nack.receivedEnd = path.receivedEnd;
+        nack.count = ranges.size();
+        const uint8_t *bytes = (const uint8_t *) &nack;
+        buf.insert(buf.end(), bytes, bytes + sizeof(nack));
+        if (!ranges.empty()) {
+            bytes = (const uint8_t *) &ranges[0];
+            buf.insert(buf.end(), bytes, bytes + ranges.size() * sizeof(nack_range_t));
+        }
+    }
+
+    void UdpServer::NotifyFramePacket(Ptr<Packet> packet) {
+        frame_t info;
+        if (packet->CopyData(info.buf, 16) < 16) {
+            return;
+        }
+        m_frames = std::max(m_frames, info.frameId + 1);
+
+        // Incomplete frames are given up well after their deadline, late packets of them are ignored
+        while (!m_pendingFrames.empty() &&
+               Simulator::Now() - m_pendingFrames.begin()->second.capture > m_frameDeadline * 4) {
+            m_frameFloor = std::max(m_frameFloor, m_pendingFrames.begin()->first + 1);
+            m_pendingFrames.erase(m_pendingFrames.begin());
+        }
+        if (info.frameId < m_frameFloor) {
+            return;
+        }
+
+        FrameState &frame = m_pendingFrames[info.frameId];
+        if (frame.count == 0) {
+            frame.capture = Time(info.captureTime);
+            frame.count = info.count;
+        }
+        if (++frame.received < frame.count) {
+            return;
+        }
+
+        Time latency = Simulator::Now() - frame.capture;
+        m_frameLatencies.push_back(latency);
+        if (latency <= m_frameDeadline) {
+            m_framesOnTime++;
+            // Playout freezes when frames in between were skipped, lost or late
+            if (frame.capture > m_lastPlayed) {
+                if (m_framesOnTime > 1 && frame.capture - m_lastPlayed > m_stallThreshold) {
+                    m_stalls++;
+                    m_stallTime += frame.capture - m_lastPlayed;
+                }
+                m_lastPlayed = frame.capture;
+            }
+        }
+        m_pendingFrames.erase(info.frameId);
+    }
+
+    Time UdpServer::GetDelayPercentile(double percentile) const {
+        uint64_t count = 0;
+        for (std::vector<uint32_t>::const_iterator iter = m_delayBins.begin(); iter != m_delayBins.end(); iter++) {
+            count += *iter;
+        }
+        if (count == 0) {
+            return Time(0);
+        }
+
+        // Upper edge of the bin holding the percentile
+        uint64_t rank = std::min<uint64_t>(count - 1, percentile / 100 * count);
+        for (uint32_t bin = 0; bin < m_delayBins.size(); bin++) {
+            if (rank < m_delayBins[bin]) {
+                return MicroSeconds(std::pow(DELAY_BIN_GROWTH, bin + 1));
+            }
+            rank -= m_delayBins[bin];
+        }
+        return MicroSeconds(std::pow(DELAY_BIN_GROWTH, DELAY_BINS));
+    }
+
     Time UdpServer::GetDelayAvg(void) const {
+        if (m_totalDelayCount == 0) {
+            return Time(0);
+        }
         return m_totalDelay / m_totalDelayCount;
     }
 
     void UdpServer::DoDispose(void) {
         NS_LOG_FUNCTION(this);
+
+        // Release the sockets so that the port can be reused by a later flow
+        if (m_socket != 0) {
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            m_socket->Close();
+            m_socket = 0;
+        }
+        if (m_socket6 != 0) {
+            m_socket6->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            m_socket6->Close();
+            m_socket6 = 0;
+        }
         Application::DoDispose();
     }
 
     void UdpServer::StartApplication(void) {
         NS_LOG_FUNCTION(this);
 
-        if (m_socket == 0) {
+        // Only open sockets for the address families installed on this node
+        if (m_socket == 0 && GetNode()->GetObject<Ipv4>() != 0) {
             TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
             m_socket = Socket::CreateSocket(GetNode(), tid);
             InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
@@ -134,9 +539,16 @@ namespace ns3 {
             }
         }
 
-        m_socket->SetRecvCallback(MakeCallback(&UdpServer::HandleRead, this));
+        if (m_socket != 0) {
+            m_socket->SetIpRecvTos(true);
+            // The server only sends feedback, so the socket's TOS and priority apply to feedback alone
+            if (m_feedbackTos != 0) {
+                m_socket->SetIpTos(m_feedbackTos);
+            }
+            m_socket->SetRecvCallback(MakeCallback(&UdpServer::HandleRead, this));
+        }
 
-        if (m_socket6 == 0) {
+        if (m_socket6 == 0 && GetNode()->GetObject<Ipv6>() != 0) {
             TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
             m_socket6 = Socket::CreateSocket(GetNode(), tid);
             Inet6SocketAddress local = Inet6SocketAddress(Ipv6Address::GetAny(), m_port);
@@ -145,7 +557,9 @@ namespace ns3 {
             }
         }
 
-        m_socket6->SetRecvCallback(MakeCallback(&UdpServer::HandleRead, this));
+        if (m_socket6 != 0) {
+            m_socket6->SetRecvCallback(MakeCallback(&UdpServer::HandleRead, this));
+        }
     }
 
     void UdpServer::StopApplication() {
@@ -154,6 +568,9 @@ namespace ns3 {
         if (m_socket != 0) {
             m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
         }
+        if (m_socket6 != 0) {
+            m_socket6->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+        }
     }
 
     void UdpServer::HandleRead(Ptr<Socket> socket) {
@@ -167,12 +584,33 @@ namespace ns3 {
             m_rxTraceWithAddresses(packet, from, localAddress);
             if (packet->GetSize() > 0) {
                 m_totalRx += packet->GetSize();
+                uint32_t packetSize = packet->GetSize();
 
                 UdpCcHeader header;
                 packet->RemoveHeader(header);
+                // IPv6 senders share the per-path state
+                bool multiplexed = m_multiplex && InetSocketAddress::IsMatchingType(from);
+                PathState &path = multiplexed ? GetSourceState(from, header.GetPath()) : GetPathState(header.GetPath());
+                path.totalRx += packetSize;
+
+                // Count congestion experienced marks set by AQM queue discs on the path
+                SocketIpTosTag tosTag;
+                if (packet->RemovePacketTag(tosTag) && (tosTag.GetTos() & ECN_CE) == ECN_CE) {
+                    m_ce++;
+                    path.ce++;
+                }
+
                 m_delayTrace(Simulator::Now() - header.GetTs());
                 m_totalDelay += (Simulator::Now() - header.GetTs());
                 m_totalDelayCount++;
+                if (m_delayHistogram) {
+                    if (m_delayBins.empty()) {
+                        m_delayBins.resize(DELAY_BINS, 0);
+                    }
+                    double delay = std::max(1.0, (Simulator::Now() - header.GetTs()).GetMicroSeconds() + 0.0);
+                    m_delayBins[std::min<uint32_t>(DELAY_BINS - 1, std::log(delay) / std::log(DELAY_BIN_GROWTH))]++;
+                }
+                path.totalDelay += (Simulator::Now() - header.GetTs());
 
                 uint32_t currentSequenceNumber = header.GetSeq();
                 if (InetSocketAddress::IsMatchingType(from)) {
@@ -193,18 +631,43 @@ namespace ns3 {
                                 " Delay: " << Simulator::Now() - header.GetTs());
                 }
 
-                m_lossCounter.NotifyReceived(currentSequenceNumber);
+                path.lossCounter.NotifyReceived(currentSequenceNumber);
+                path.received++;
                 m_received++;
+                if (m_reliable) {
+                    NotifyDelivered(path, currentSequenceNumber, packetSize);
+                }
+                if (m_frameDeadline > Time(0)) {
+                    NotifyFramePacket(packet);
+                }
 
-                // Feedback every 5 ms
-                if (Simulator::Now() - m_lastFeedback > MilliSeconds(5)) {
-                    m_lastFeedback = Simulator::Now();
-                    message_t msg;
-                    msg.recvTime = Simulator::Now().GetInteger();
-                    msg.lost = GetLost();
+                // Feedback every UDP_CC_FEEDBACK_PERIOD ms on each path
+                if (Simulator::Now() - path.lastFeedback > MilliSeconds(UDP_CC_FEEDBACK_PERIOD)) {
+                    path.lastFeedback = Simulator::Now();
+                    std::vector<uint8_t> buf;
+                    if (!m_compactFeedback) {
+                        message_t msg;
+                        msg.recvTime = Simulator::Now().GetInteger();
+                        msg.lost = path.lossCounter.GetLost();
+                        msg.ce = path.ce;
+                        buf.assign(msg.buf, msg.buf + 16);
+                    }
+                    if (m_reliable) {
+                        WriteNacks(path, buf);
+                    }
 
-                    Ptr<Packet> feedbackPacket = Create<Packet>(msg.buf, 12);
-                    feedbackPacket->AddHeader(header);
+                    Ptr<Packet> feedbackPacket = buf.empty() ? Create<Packet>() : Create<Packet>(&buf[0], buf.size());
+                    if (m_compactFeedback) {
+                        UdpCcFeedbackHeader feedback;
+                        feedback.SetSeq(currentSequenceNumber);
+                        feedback.SetPath(header.GetPath());
+                        feedback.SetDelay(Simulator::Now() - header.GetTs());
+                        feedback.SetLost(path.lossCounter.GetLost());
+                        feedback.SetCe(path.ce);
+                        feedbackPacket->AddHeader(feedback);
+                    } else {
+                        feedbackPacket->AddHeader(header);
+                    }
                     socket->SendTo(feedbackPacket, 0, from);
                 }
             }
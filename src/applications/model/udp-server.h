@@ -30,6 +30,11 @@
 #include "ns3/traced-callback.h"
 #include "packet-loss-counter.h"
 
+#include <map>
+#include <set>
+#include <vector>
+#include <deque>
+
 namespace ns3 {
     /**
      * \ingroup applications
@@ -44,6 +49,24 @@ namespace ns3 {
      * UDP packets carry a 32bits sequence number followed by a 64bits time
      * stamp in their payloads. The application uses the sequence number
      * to determine if a packet is lost, and the time stamp to compute the delay.
+     *
+     * In reliable mode the server also tracks which sequence numbers have been
+     * delivered on each path and appends the missing ranges (NACKs) to its
+     * feedback, so that the client can retransmit them.
+     *
+     * In multiplex mode the receive state (loss, delay, feedback pacing, NACKs)
+     * is kept per sender address and port in an open-addressing hash table,
+     * so that one server port can serve thousands of senders. Frame
+     * statistics stay per server.
+     *
+     * Feedback either echoes the data header or, in compact mode, carries only
+     * the fields the client's controller needs. It can be sent with its own TOS
+     * so that it bypasses bulk traffic in priority queue discs.
+     *
+     * When a frame deadline is set, the payload starts with the frame
+     * information of the client's frame mode. The server reassembles frames and
+     * records their latency from capture to the arrival of their last packet,
+     * whether they meet the playout deadline, and the playout stalls.
      */
     class UdpServer : public Application {
     public:
@@ -89,6 +112,110 @@ namespace ns3 {
 
         Time GetDelayAvg(void) const;
 
+        /**
+         * \param percentile the percentile, in [0, 100]
+         * \return the delay percentile of the received packets, within 2% (DelayHistogram set)
+         */
+        Time GetDelayPercentile(double percentile) const;
+
+        /**
+         * \brief Returns the number of packets received with a congestion experienced mark
+         * \return the number of CE marked packets
+         */
+        uint32_t GetCe(void) const;
+
+        /**
+         * \brief Returns the number of paths (subflows) the sender has used
+         * \return the number of paths
+         */
+        uint32_t GetPathCount(void) const;
+
+        /**
+         * \param path the path index
+         * \return the total bytes received on the path
+         */
+        uint64_t GetPathTotalRx(uint8_t path) const;
+
+        /**
+         * \param path the path index
+         * \return the number of packets lost on the path
+         */
+        uint32_t GetPathLost(uint8_t path) const;
+
+        /**
+         * \param path the path index
+         * \return the average delay of the path
+         */
+        Time GetPathDelayAvg(uint8_t path) const;
+
+        /**
+         * \brief Returns the number of senders seen in multiplex mode
+         * \return the number of senders
+         */
+        uint32_t GetSourceCount(void) const;
+
+        /**
+         * \param from the address and port of a sender
+         * \return the total bytes received from the sender (multiplex mode)
+         */
+        uint64_t GetSourceTotalRx(const Address &from) const;
+
+        /**
+         * \param from the address and port of a sender
+         * \return the number of packets of the sender lost (multiplex mode)
+         */
+        uint32_t GetSourceLost(const Address &from) const;
+
+        /**
+         * \param from the address and port of a sender
+         * \return the average delay of the sender's packets (multiplex mode)
+         */
+        Time GetSourceDelayAvg(const Address &from) const;
+
+        /**
+         * \brief Returns the bytes of distinct packets received, duplicates excluded (reliable mode)
+         * \return the delivered bytes
+         */
+        uint64_t GetDelivered(void) const;
+
+        /**
+         * \brief Returns the time the last missing packet has been filled in (reliable mode)
+         * \return the time of the last in-order delivery progress
+         */
+        Time GetLastDelivery(void) const;
+
+        /**
+         * \brief Returns the number of frames the sender has captured, skipped ones included (frame mode)
+         * \return the number of frames
+         */
+        uint32_t GetFrames(void) const;
+
+        /**
+         * \return the number of frames completely received before their playout deadline
+         */
+        uint32_t GetFramesOnTime(void) const;
+
+        /**
+         * \return the number of frames completely received after their playout deadline
+         */
+        uint32_t GetFramesLate(void) const;
+
+        /**
+         * \param percentile the percentile, in [0, 100]
+         * \return the latency percentile of the completely received frames
+         */
+        Time GetFrameLatency(double percentile) const;
+
+        /**
+         * \return the number of playout stalls, gaps between on-time frames longer than the stall threshold
+         */
+        uint32_t GetStalls(void) const;
+
+        /**
+         * \return the total duration of the playout stalls
+         */
+        Time GetStallTime(void) const;
+
     protected:
         virtual void DoDispose(void);
 
@@ -105,12 +232,95 @@ namespace ns3 {
          */
         void HandleRead(Ptr<Socket> socket);
 
+        /// Receive state of one path (subflow), each path has its own sequence numbers
+        struct PathState {
+            PathState();
+            PacketLossCounter lossCounter; //!< Lost packet counter
+            uint64_t received;
+            uint64_t totalRx;
+            Time totalDelay;
+            uint32_t ce;
+            Time lastFeedback;
+            uint32_t nextExpected; //!< All packets below have been delivered
+            uint32_t receivedEnd; //!< One past the highest sequence number received
+            uint64_t delivered; //!< Bytes of distinct packets
+            Time lastDelivery;
+        };
+
+        /**
+         * \param path the path index
+         * \return the state of the path, created on first use
+         */
+        PathState &GetPathState(uint8_t path);
+
+        /**
+         * \param from the address and port of the sender
+         * \param path the path index
+         * \return the state of the path of the sender, created on first use
+         */
+        PathState &GetSourceState(const Address &from, uint8_t path);
+
+        /**
+         * \param key the sender and path key
+         * \return the index of the state in m_sources, or -1 if the key is unknown
+         */
+        int32_t FindSource(uint64_t key) const;
+
+        /**
+         * \brief Record the delivery of a packet on a path for the NACK feedback
+         * \param path the path state
+         * \param seq the sequence number of the packet
+         * \param size the size of the packet
+         */
+        void NotifyDelivered(PathState &path, uint32_t seq, uint32_t size);
+
+        /**
+         * \brief Append the cumulative ack and the missing ranges of a path to a feedback
+         * \param path the path state
+         * \param buf feedback payload the NACK block is appended to
+         */
+        void WriteNacks(const PathState &path, std::vector<uint8_t> &buf) const;
+
+        /**
+         * \brief Account a packet of a frame
+         * \param packet the payload, starting with the frame information
+         */
+        void NotifyFramePacket(Ptr<Packet> packet);
+
+        /// Reassembly state of a frame
+        struct FrameState {
+            Time capture;
+            uint16_t count;
+            uint16_t received;
+        };
+
         uint16_t m_port; //!< Port on which we listen for incoming packets.
         Ptr<Socket> m_socket; //!< IPv4 Socket
         Ptr<Socket> m_socket6; //!< IPv6 Socket
         uint64_t m_received; //!< Number of received packets
         uint64_t m_totalRx; //!< Total bytes received
-        PacketLossCounter m_lossCounter; //!< Lost packet counter
+        uint16_t m_packetWindowSize; //!< Size of the window used for checking loss
+        bool m_reliable; //!< Track delivered packets and send NACKs in the feedback
+        uint32_t m_maxNackRanges; //!< Maximum number of missing ranges in one feedback
+        bool m_compactFeedback; //!< Send the compact feedback header instead of echoing the data header
+        uint8_t m_feedbackTos; //!< TOS of the feedback packets, selects their priority band
+        Time m_frameDeadline; //!< Playout deadline of a frame, zero when packets carry no frames
+        Time m_stallThreshold; //!< Gap between two played frames counted as a stall
+        std::map<uint32_t, FrameState> m_pendingFrames;
+        uint32_t m_frameFloor; //!< Frames below are complete or expired
+        uint32_t m_frames;
+        uint32_t m_framesOnTime;
+        std::vector<Time> m_frameLatencies;
+        Time m_lastPlayed; //!< Capture time of the latest frame played on time
+        uint32_t m_stalls;
+        Time m_stallTime;
+        std::map<uint8_t, PathState> m_paths;
+        std::map<const PathState *, std::set<uint32_t> > m_outOfOrder; //!< Delivered packets above nextExpected of each path (Reliable)
+
+        bool m_multiplex; //!< Keep the receive state per sender address and port
+        std::deque<PathState> m_sources; //!< Receive state of each sender and path, never relocated
+        std::vector<uint64_t> m_sourceKeys; //!< Address, port and path of each entry of m_sources
+        std::vector<uint32_t> m_sourceTable; //!< Open-addressing hash table of m_sources indexes plus one, 0 when empty
 
         /// Callbacks for tracing the packet Rx events
         TracedCallback<Ptr<const Packet> > m_rxTrace;
@@ -120,9 +330,11 @@ namespace ns3 {
 
         // Callbacks for tracing the delay at the packet Rx events
         TracedCallback<Time> m_delayTrace;
-        Time m_lastFeedback;
         Time m_totalDelay;
         uint64_t m_totalDelayCount;
+        bool m_delayHistogram; //!< Count the delays in logarithmic bins for percentiles
+        std::vector<uint32_t> m_delayBins; //!< Packets per 2% wide delay bin from 1 us
+        uint32_t m_ce; //!< Number of CE marked packets
     };
 
 } // namespace ns3
@@ -0,0 +1,332 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+#include "ns3/trace-source-accessor.h"
+#include "tcp-l4-protocol.h"
+#include "tcp-socket-factory.h"
+#include "tcp-req-resp.h"
+#include <algorithm>
+
+namespace ns3 {
+
+    NS_LOG_COMPONENT_DEFINE("TcpReqResp");
+    NS_OBJECT_ENSURE_REGISTERED(TcpReqRespClient);
+    NS_OBJECT_ENSURE_REGISTERED(TcpReqRespServer);
+
+    TypeId TcpReqRespClient::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TcpReqRespClient")
+            .SetParent<Application>()
+            .SetGroupName("Internet")
+            .AddConstructor<TcpReqRespClient>()
+            .AddAttribute("Remote",
+                          "The address of the TcpReqRespServer",
+                          AddressValue(),
+                          MakeAddressAccessor(&TcpReqRespClient::m_peer),
+                          MakeAddressChecker())
+            .AddAttribute("RequestSize",
+                          "Bytes of a request",
+                          UintegerValue(200),
+                          MakeUintegerAccessor(&TcpReqRespClient::m_requestSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ResponseSize",
+                          "Bytes of a response, the same as ResponseSize of the server",
+                          UintegerValue(50000),
+                          MakeUintegerAccessor(&TcpReqRespClient::m_responseSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ThinkTime",
+                          "Seconds between the end of a response and the next request",
+                          StringValue("ns3::ExponentialRandomVariable[Mean=1.0]"),
+                          MakePointerAccessor(&TcpReqRespClient::m_thinkTime),
+                          MakePointerChecker<RandomVariableStream>())
+            .AddAttribute("MaxBytes",
+                          "Response bytes after which no more requests are sent, 0 for no limit",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&TcpReqRespClient::m_maxBytes),
+                          MakeUintegerChecker<uint64_t>())
+            .AddTraceSource("Rx",
+                            "A packet of a response has been received",
+                            MakeTraceSourceAccessor(&TcpReqRespClient::m_rxTrace),
+                            "ns3::Packet::AddressTracedCallback")
+        ;
+        return tid;
+    }
+
+    TcpReqRespClient::TcpReqRespClient() {
+        NS_LOG_FUNCTION(this);
+        m_totalRx = 0;
+        m_responseRx = 0;
+        m_responses = 0;
+    }
+
+    TcpReqRespClient::~TcpReqRespClient() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    uint64_t TcpReqRespClient::GetTotalRx(void) const {
+        return m_totalRx;
+    }
+
+    uint32_t TcpReqRespClient::GetResponses(void) const {
+        return m_responses;
+    }
+
+    void TcpReqRespClient::DoDispose(void) {
+        NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_requestEvent);
+        if (m_socket != 0) {
+            m_socket->SetConnectCallback(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            m_socket->Close();
+            m_socket = 0;
+        }
+        m_thinkTime = 0;
+        Application::DoDispose();
+    }
+
+    void TcpReqRespClient::StartApplication(void) {
+        NS_LOG_FUNCTION(this);
+
+        if (m_socket == 0) {
+            m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+            if (m_socket->Bind() == -1) {
+                NS_FATAL_ERROR("Failed to bind socket");
+            }
+            m_socket->SetConnectCallback(MakeCallback(&TcpReqRespClient::ConnectionSucceeded, this),
+                                         MakeCallback(&TcpReqRespClient::ConnectionFailed, this));
+            m_socket->SetRecvCallback(MakeCallback(&TcpReqRespClient::HandleRead, this));
+            m_socket->Connect(m_peer);
+        }
+    }
+
+    void TcpReqRespClient::StopApplication(void) {
+        NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_requestEvent);
+        if (m_socket != 0) {
+            m_socket->Close();
+        }
+    }
+
+    void TcpReqRespClient::ConnectionSucceeded(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        SendRequest();
+    }
+
+    void TcpReqRespClient::ConnectionFailed(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        NS_LOG_INFO("Connection to " << InetSocketAddress::ConvertFrom(m_peer).GetIpv4() << " failed");
+    }
+
+    void TcpReqRespClient::SendRequest(void) {
+        NS_LOG_FUNCTION(this);
+        if (m_maxBytes > 0 && m_totalRx >= m_maxBytes) {
+            return;
+        }
+        if (m_socket->Send(Create<Packet>(m_requestSize)) < 0) {
+            NS_LOG_INFO("Error while sending a request of " << m_requestSize << " bytes");
+        }
+    }
+
+    void TcpReqRespClient::HandleRead(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from))) {
+            if (packet->GetSize() == 0) {
+                break;
+            }
+            m_totalRx += packet->GetSize();
+            m_responseRx += packet->GetSize();
+            m_rxTrace(packet, from);
+        }
+
+        // One request is outstanding at a time, so the bytes beyond a response belong to none
+        if (m_responseRx >= m_responseSize && !m_requestEvent.IsRunning()) {
+            m_responseRx = 0;
+            m_responses++;
+            m_requestEvent = Simulator::Schedule(Seconds(std::max(0.0, m_thinkTime->GetValue())),
+                                                 &TcpReqRespClient::SendRequest, this);
+        }
+    }
+
+    TypeId TcpReqRespServer::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TcpReqRespServer")
+            .SetParent<Application>()
+            .SetGroupName("Internet")
+            .AddConstructor<TcpReqRespServer>()
+            .AddAttribute("Port",
+                          "Port on which requests are accepted",
+                          UintegerValue(80),
+                          MakeUintegerAccessor(&TcpReqRespServer::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("RequestSize",
+                          "Bytes of a request",
+                          UintegerValue(200),
+                          MakeUintegerAccessor(&TcpReqRespServer::m_requestSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ResponseSize",
+                          "Bytes of a response",
+                          UintegerValue(50000),
+                          MakeUintegerAccessor(&TcpReqRespServer::m_responseSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("SendSize",
+                          "Bytes given to the socket per Send call",
+                          UintegerValue(1000),
+                          MakeUintegerAccessor(&TcpReqRespServer::m_sendSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddTraceSource("Tx",
+                            "A packet of a response has been given to the socket",
+                            MakeTraceSourceAccessor(&TcpReqRespServer::m_txTrace),
+                            "ns3::Packet::TracedCallback")
+        ;
+        return tid;
+    }
+
+    TcpReqRespServer::TcpReqRespServer() {
+        NS_LOG_FUNCTION(this);
+        m_customCongestionControl = false;
+    }
+
+    TcpReqRespServer::~TcpReqRespServer() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    void TcpReqRespServer::SetCongestionControl(TypeId congestionControl) {
+        NS_LOG_FUNCTION(this << congestionControl);
+        NS_ASSERT_MSG(m_socket == 0, "The congestion control is set before the application starts");
+        m_congestionControl = congestionControl;
+        m_customCongestionControl = true;
+    }
+
+    void TcpReqRespServer::DoDispose(void) {
+        NS_LOG_FUNCTION(this);
+        CloseSockets();
+        Application::DoDispose();
+    }
+
+    void TcpReqRespServer::StartApplication(void) {
+        NS_LOG_FUNCTION(this);
+
+        if (m_socket == 0) {
+            // Accepted sockets are forked from the listening socket and keep its congestion control
+            if (m_customCongestionControl) {
+                m_socket = GetNode()->GetObject<TcpL4Protocol>()->CreateSocket(m_congestionControl);
+            } else {
+                m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+            }
+            if (m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port)) == -1) {
+                NS_FATAL_ERROR("Failed to bind socket");
+            }
+            m_socket->Listen();
+        }
+        m_socket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+                                    MakeCallback(&TcpReqRespServer::HandleAccept, this));
+    }
+
+    void TcpReqRespServer::StopApplication(void) {
+        NS_LOG_FUNCTION(this);
+        CloseSockets();
+    }
+
+    void TcpReqRespServer::CloseSockets(void) {
+        for (std::map<Ptr<Socket>, Connection>::iterator iter = m_connections.begin(); iter != m_connections.end(); iter++) {
+            Ptr<Socket> socket = iter->first;
+            socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            socket->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+            socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+            socket->Close();
+        }
+        m_connections.clear();
+        if (m_socket != 0) {
+            m_socket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+                                        MakeNullCallback<void, Ptr<Socket>, const Address &>());
+            m_socket->Close();
+            m_socket = 0;
+        }
+    }
+
+    void TcpReqRespServer::HandleAccept(Ptr<Socket> socket, const Address &from) {
+        NS_LOG_FUNCTION(this << socket << from);
+        Connection &connection = m_connections[socket];
+        connection.requestRx = 0;
+        connection.pending = 0;
+        socket->SetRecvCallback(MakeCallback(&TcpReqRespServer::HandleRead, this));
+        socket->SetSendCallback(MakeCallback(&TcpReqRespServer::HandleSend, this));
+        socket->SetCloseCallbacks(MakeCallback(&TcpReqRespServer::HandleClose, this),
+                                  MakeCallback(&TcpReqRespServer::HandleClose, this));
+    }
+
+    void TcpReqRespServer::HandleRead(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        std::map<Ptr<Socket>, Connection>::iterator iter = m_connections.find(socket);
+        if (iter == m_connections.end()) {
+            return;
+        }
+        Connection &connection = iter->second;
+
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv())) {
+            if (packet->GetSize() == 0) {
+                break;
+            }
+            connection.requestRx += packet->GetSize();
+            while (connection.requestRx >= m_requestSize) {
+                connection.requestRx -= m_requestSize;
+                connection.pending += m_responseSize;
+            }
+        }
+        SendPending(socket);
+    }
+
+    void TcpReqRespServer::HandleSend(Ptr<Socket> socket, uint32_t available) {
+        NS_LOG_FUNCTION(this << socket << available);
+        SendPending(socket);
+    }
+
+    void TcpReqRespServer::HandleClose(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        m_connections.erase(socket);
+    }
+
+    void TcpReqRespServer::SendPending(Ptr<Socket> socket) {
+        std::map<Ptr<Socket>, Connection>::iterator iter = m_connections.find(socket);
+        if (iter == m_connections.end()) {
+            return;
+        }
+        Connection &connection = iter->second;
+
+        while (connection.pending > 0 && socket->GetTxAvailable() > 0) {
+            uint32_t size = std::min<uint64_t>(connection.pending, std::min(m_sendSize, socket->GetTxAvailable()));
+            Ptr<Packet> packet = Create<Packet>(size);
+            int actual = socket->Send(packet);
+            if (actual <= 0) {
+                break;
+            }
+            connection.pending -= actual;
+            m_txTrace(packet);
+        }
+    }
+
+} // namespace ns3
@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_REQ_RESP_H
+#define TCP_REQ_RESP_H
+
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/address.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+
+#include <map>
+
+namespace ns3 {
+
+    class Socket;
+    class Packet;
+
+    /**
+     * \ingroup internet
+     *
+     * \brief Web-like TCP client: requests a response over a persistent connection,
+     * waits for all of it, thinks, and requests the next one.
+     *
+     * The client mostly receives, so it is installed on the receiver of the
+     * flow and the Rx trace has the signature of the one of PacketSink.
+     */
+    class TcpReqRespClient : public Application {
+    public:
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        TcpReqRespClient();
+        virtual ~TcpReqRespClient();
+
+        /**
+         * \return the number of response bytes received
+         */
+        uint64_t GetTotalRx(void) const;
+
+        /**
+         * \return the number of complete responses
+         */
+        uint32_t GetResponses(void) const;
+
+    protected:
+        virtual void DoDispose(void);
+
+    private:
+        virtual void StartApplication(void);
+        virtual void StopApplication(void);
+
+        /**
+         * \brief Send the next request, unless MaxBytes has been received
+         */
+        void SendRequest(void);
+
+        void ConnectionSucceeded(Ptr<Socket> socket);
+        void ConnectionFailed(Ptr<Socket> socket);
+
+        /**
+         * \brief Count the response bytes and schedule the next request after a complete response
+         * \param socket the connected socket
+         */
+        void HandleRead(Ptr<Socket> socket);
+
+        Address m_peer; //!< Address of the TcpReqRespServer
+        uint32_t m_requestSize; //!< Bytes of a request
+        uint32_t m_responseSize; //!< Bytes of a response, as configured on the server
+        Ptr<RandomVariableStream> m_thinkTime; //!< Seconds between a response and the next request
+        uint64_t m_maxBytes; //!< Response bytes after which no more requests are sent, 0 for no limit
+
+        Ptr<Socket> m_socket;
+        EventId m_requestEvent;
+        uint64_t m_totalRx;
+        uint32_t m_responseRx; //!< Bytes of the pending response received so far
+        uint32_t m_responses;
+
+        TracedCallback<Ptr<const Packet>, const Address &> m_rxTrace;
+    };
+
+    /**
+     * \brief Server of TcpReqRespClient: answers every RequestSize bytes received on a connection
+     * with ResponseSize bytes.
+     *
+     * The server sends the data of the flow, so its congestion control can be
+     * chosen per application instead of per node.
+     */
+    class TcpReqRespServer : public Application {
+    public:
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        TcpReqRespServer();
+        virtual ~TcpReqRespServer();
+
+        /**
+         * \brief Use a congestion control instead of ns3::TcpL4Protocol::SocketType, before the application starts
+         * \param congestionControl a TcpCongestionOps type
+         */
+        void SetCongestionControl(TypeId congestionControl);
+
+    protected:
+        virtual void DoDispose(void);
+
+    private:
+        virtual void StartApplication(void);
+        virtual void StopApplication(void);
+
+        void HandleAccept(Ptr<Socket> socket, const Address &from);
+        void HandleRead(Ptr<Socket> socket);
+        void HandleSend(Ptr<Socket> socket, uint32_t available);
+        void HandleClose(Ptr<Socket> socket);
+
+        /**
+         * \brief Send as much of the pending responses of a connection as the send buffer takes
+         * \param socket the accepted socket
+         */
+        void SendPending(Ptr<Socket> socket);
+
+        /**
+         * \brief Close every socket and detach the callbacks
+         */
+        void CloseSockets(void);
+
+        // Progress of the requests of a connection
+        struct Connection {
+            uint32_t requestRx; //!< Bytes of the pending request received so far
+            uint64_t pending; //!< Response bytes not yet given to the socket
+        };
+
+        uint16_t m_port;
+        uint32_t m_requestSize;
+        uint32_t m_responseSize;
+        uint32_t m_sendSize; //!< Bytes given to the socket per Send call
+        TypeId m_congestionControl;
+        bool m_customCongestionControl;
+
+        Ptr<Socket> m_socket; //!< Listening socket
+        std::map<Ptr<Socket>, Connection> m_connections;
+
+        TracedCallback<Ptr<const Packet> > m_txTrace;
+    };
+
+} // namespace ns3
+
+#endif /* TCP_REQ_RESP_H */
@@ -0,0 +1,684 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "udp-cc-controller.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#define SMOOTH(x, y, xr, yr) ((((x) * (xr)) + ((y) * (yr))) / ((xr) + (yr)))
+
+#define ECN_ECT1 0x01
+#define ECN_ECT0 0x02
+
+namespace ns3 {
+
+    NS_LOG_COMPONENT_DEFINE("UdpCcController");
+    NS_OBJECT_ENSURE_REGISTERED(UdpCcController);
+    NS_OBJECT_ENSURE_REGISTERED(UdpCcStateCache);
+
+    TypeId UdpCcController::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::UdpCcController")
+            .SetParent<Object>()
+            .SetGroupName("Internet")
+            .AddConstructor<UdpCcController>()
+            .AddAttribute("DelayMinWindow",
+                          "The horizon of the minimum delay filter, 0 to keep the all-time minimum",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&UdpCcController::m_delayMinWindow),
+                          MakeTimeChecker())
+            .AddAttribute("DelayMaxWindow",
+                          "The horizon of the maximum delay filter, 0 to keep the all-time maximum",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&UdpCcController::m_delayMaxWindow),
+                          MakeTimeChecker())
+            .AddAttribute("Ecn",
+                          "Mark outgoing packets ECN capable and reduce the rate on congestion experienced feedback",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpCcController::m_ecn),
+                          MakeBooleanChecker())
+            .AddAttribute("EcnScalable",
+                          "Use ECT(1) and a scalable response proportional to the marked fraction instead of the classic response",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpCcController::m_ecnScalable),
+                          MakeBooleanChecker())
+            .AddAttribute("EcnGain",
+                          "Gain of the moving average of the marked fraction used by the scalable response",
+                          DoubleValue(1.0 / 16),
+                          MakeDoubleAccessor(&UdpCcController::m_ecnGain),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("DecisionSampling",
+                          "Fire the Decision trace for every Nth decision, 0 to disable it (the per-reason counters always count)",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&UdpCcController::m_decisionSampling),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("TrendlineSlope", "A trendline slope when packet has been received",
+                            MakeTraceSourceAccessor(&UdpCcController::m_trendlineSlope),
+                            "ns3::TracedValueCallback::Double")
+            .AddTraceSource("Interval", "The time to wait between packets",
+                            MakeTraceSourceAccessor(&UdpCcController::m_interval),
+                            "ns3::TracedValueCallback::Time")
+            .AddTraceSource("Lost", "The number of lost packets when packet has been received",
+                            MakeTraceSourceAccessor(&UdpCcController::m_lostTrace),
+                            "ns3::TracedValueCallback::Uint32")
+            .AddTraceSource("TargetInterval", "The number of lost packets when packet has been received",
+                            MakeTraceSourceAccessor(&UdpCcController::m_targetInterval),
+                            "ns3::TracedValueCallback::Time")
+            .AddTraceSource("Ce", "The number of congestion experienced marks when packet has been received",
+                            MakeTraceSourceAccessor(&UdpCcController::m_ceTrace),
+                            "ns3::TracedValueCallback::Uint32")
+            .AddTraceSource("EcnAlpha", "The moving average of the marked fraction",
+                            MakeTraceSourceAccessor(&UdpCcController::m_ecnAlpha),
+                            "ns3::TracedValueCallback::Double")
+            .AddTraceSource("Decision", "The rule, inputs and outcome of a sampled rate decision",
+                            MakeTraceSourceAccessor(&UdpCcController::m_decisionTrace),
+                            "ns3::UdpCcController::DecisionTracedCallback")
+        ;
+        return tid;
+    }
+
+    WindowedFilter::WindowedFilter(bool max, Time initial) : m_max(max) {
+        Reset(Time(0), initial);
+    }
+
+    Time WindowedFilter::Update(Time window, Time now, Time value) {
+        // A new extreme, or every kept sample has aged out
+        if (!IsBetter(m_samples[0].value, value) ||
+            (window > Time(0) && now - m_samples[2].time > window)) {
+            Reset(now, value);
+            return value;
+        }
+
+        Sample sample;
+        sample.time = now;
+        sample.value = value;
+        if (!IsBetter(m_samples[1].value, value)) {
+            m_samples[2] = m_samples[1] = sample;
+        } else if (!IsBetter(m_samples[2].value, value)) {
+            m_samples[2] = sample;
+        }
+        if (window == Time(0)) {
+            return m_samples[0].value;
+        }
+
+        // Age out the best sample, and refresh the later sub-windows with the new sample
+        Time age = now - m_samples[0].time;
+        if (age > window) {
+            m_samples[0] = m_samples[1];
+            m_samples[1] = m_samples[2];
+            m_samples[2] = sample;
+            if (now - m_samples[0].time > window) {
+                m_samples[0] = m_samples[1];
+                m_samples[1] = m_samples[2];
+                m_samples[2] = sample;
+            }
+        } else if (m_samples[1].time == m_samples[0].time && age > window / 4) {
+            m_samples[2] = m_samples[1] = sample;
+        } else if (m_samples[2].time == m_samples[1].time && age > window / 2) {
+            m_samples[2] = sample;
+        }
+        return m_samples[0].value;
+    }
+
+    Time WindowedFilter::Get(void) const {
+        return m_samples[0].value;
+    }
+
+    bool WindowedFilter::IsBetter(Time value, Time than) const {
+        return m_max ? value > than : value < than;
+    }
+
+    void WindowedFilter::Reset(Time now, Time value) {
+        for (uint32_t i = 0; i < 3; i++) {
+            m_samples[i].time = now;
+            m_samples[i].value = value;
+        }
+    }
+
+    TrendlineWindow::TrendlineWindow() : m_first(0), m_size(0) {
+    }
+
+    void TrendlineWindow::Push(Time sendTime, Time recvTime) {
+        uint32_t slot;
+        if (m_size < LIST_SIZE_UPPER_LIMIT) {
+            slot = (m_first + m_size) % LIST_SIZE_UPPER_LIMIT;
+            m_size++;
+        } else {
+            // Adjust(fix) calculation window
+            slot = m_first;
+            m_first = (m_first + 1) % LIST_SIZE_UPPER_LIMIT;
+        }
+        m_sendTimes[slot] = sendTime;
+        m_recvTimes[slot] = recvTime;
+    }
+
+    uint32_t TrendlineWindow::GetSize(void) const {
+        return m_size;
+    }
+
+    Time TrendlineWindow::GetSendTime(uint32_t i) const {
+        NS_ASSERT(i < m_size);
+        return m_sendTimes[(m_first + i) % LIST_SIZE_UPPER_LIMIT];
+    }
+
+    Time TrendlineWindow::GetRecvTime(uint32_t i) const {
+        NS_ASSERT(i < m_size);
+        return m_recvTimes[(m_first + i) % LIST_SIZE_UPPER_LIMIT];
+    }
+
+    UdpCcLaw::UdpCcLaw() : m_delayMin(false, MilliSeconds(1000)),
+                           m_delayMax(true, MilliSeconds(0)) {
+        m_interval = MicroSeconds(500);
+        m_deadman = false;
+        m_warm = false;
+        m_deadmanInterval = Time(0);
+        m_deadmanTime = Time(0);
+        m_increaseWeight = 1.0;
+        m_trendlineSlope = 0;
+        m_recvIntervalAvg = Time(0);
+        m_delayMinInterval = MicroSeconds(10000);
+        m_delayMaxInterval = MicroSeconds(200);
+        m_targetInterval = MilliSeconds(1000);
+        m_totalLost = 0;
+        m_lost = 0;
+        m_totalCe = 0;
+        m_lastFeedbackSeq = 0;
+        m_ceResponseTime = Time(0);
+        m_ce = 0;
+        m_ecnAlpha = 0;
+        m_delay = Time(0);
+        m_decisionDelayMin = Time(0);
+        m_decisionDelayMax = Time(0);
+        m_resumed = false;
+        m_resumedFrom = Time(0);
+        m_resumedTo = Time(0);
+    }
+
+    Time UdpCcLaw::GetInterval(void) const {
+        return m_interval;
+    }
+
+    void UdpCcLaw::SetIncreaseWeight(double weight) {
+        m_increaseWeight = std::max(0.0, std::min(1.0, weight));
+    }
+
+    void UdpCcLaw::SetState(const UdpCcParams &params, const UdpCcState &state, Time now) {
+        m_interval = std::max(MicroSeconds(200), std::min(state.interval, MicroSeconds(10000)));
+        m_recvIntervalAvg = m_interval;
+        m_delayMin.Update(params.delayMinWindow, now, state.delayMin);
+        m_delayMax.Update(params.delayMaxWindow, now, state.delayMax);
+        m_delayMinInterval = state.delayMinInterval;
+        m_delayMaxInterval = state.delayMaxInterval;
+        m_targetInterval = (m_delayMaxInterval + m_delayMinInterval) / 2;
+        m_warm = true;
+    }
+
+    bool UdpCcLaw::GetState(UdpCcState &state) const {
+        if (m_window.GetSize() < LIST_SIZE_LOWER_LIMIT || m_deadman) {
+            return false;
+        }
+        state.interval = m_interval;
+        state.delayMin = m_delayMin.Get();
+        state.delayMax = m_delayMax.Get();
+        state.delayMinInterval = m_delayMinInterval;
+        state.delayMaxInterval = m_delayMaxInterval;
+        return true;
+    }
+
+    void UdpCcLaw::OnFeedbackTimeout(double backoff, Time maxInterval, Time now) {
+        if (!m_deadman) {
+            m_deadman = true;
+            m_deadmanInterval = m_interval;
+        }
+        // Beyond the bounds of UpdateInterval, and without smoothing so that the queue drains now
+        m_deadmanTime = now;
+        m_interval = std::max(m_interval, std::min(Time::From(m_interval.GetDouble() * backoff), maxInterval));
+    }
+
+    void UdpCcLaw::UpdateInterval(Time newInterval) {
+        // Coupled controllers only take their share of a rate increase
+        if (newInterval < m_interval && m_increaseWeight < 1.0) {
+            newInterval = m_interval - Time::From((m_interval - newInterval).GetDouble() * m_increaseWeight);
+        }
+
+        // Change send interval when new interval is within lower & upper bound
+        if (MicroSeconds(200) <= newInterval && newInterval <= MicroSeconds(10000)) {
+            m_interval = SMOOTH(m_interval, newInterval, 9, 1);
+        }
+    }
+
+    void UdpCcLaw::BackOff(Time newInterval) {
+        m_interval = std::max(m_interval, std::min(newInterval, MicroSeconds(10000)));
+    }
+
+    uint8_t UdpCcLaw::OnFeedback(const UdpCcParams &params, uint32_t lost, uint32_t ce, uint32_t seq,
+                                 Time sendTime, Time recvTime, Time sendInterval) {
+        // Feedback is back: the rate before it went missing is resumed in steps, as the queue may have grown
+        // meanwhile, and only on packets sent after the last backoff, as older ones do not show the backed off rate
+        m_resumed = false;
+        if (m_deadman && sendTime > m_deadmanTime) {
+            m_resumed = true;
+            m_resumedFrom = m_interval;
+            m_interval = std::min(m_interval, (m_interval + m_deadmanInterval) / 2);
+            if (m_interval <= m_deadmanInterval * 17 / 16) {
+                m_deadman = false;
+                m_interval = std::min(m_interval, m_deadmanInterval);
+            }
+            m_resumedTo = m_interval;
+        }
+
+        uint8_t reason;
+        m_window.Push(sendTime, recvTime);
+
+        // Calculate packet loss
+        m_lost = lost - m_totalLost;
+        m_totalLost = lost;
+
+        // Calculate congestion experienced marks and the marked fraction since the last feedback
+        m_ce = ce - m_totalCe;
+        m_totalCe = ce;
+        uint32_t delivered = seq > m_lastFeedbackSeq ? seq - m_lastFeedbackSeq : 1;
+        m_lastFeedbackSeq = std::max(m_lastFeedbackSeq, seq); // Retransmissions carry older sequence numbers
+        m_ecnAlpha = (1 - params.ecnGain) * m_ecnAlpha + params.ecnGain * std::min(1.0, (double) m_ce / delivered);
+
+        // Calculate moving send interval when the packet was sent
+        m_recvIntervalAvg = SMOOTH(m_recvIntervalAvg, sendInterval, 9, 1);
+
+        Time smoothedDelay(0), delayMin(0), delayMax(0);
+        uint32_t size = m_window.GetSize();
+        if (size >= LIST_SIZE_LOWER_LIMIT) {
+            // Calculate trendline slope and current delay(smoothed)
+            Time prevSendTime(m_window.GetSendTime(0)), prevRecvTime(m_window.GetRecvTime(0));
+            Time baseRecvTime(m_window.GetRecvTime(1));
+
+            smoothedDelay = prevRecvTime - prevSendTime;
+            Time accumulatedDelayDelta(0);
+            Time smoothedDelayDelta(0);
+
+            Time x[LIST_SIZE_UPPER_LIMIT], y[LIST_SIZE_UPPER_LIMIT];
+            Time xSum(0), ySum(0);
+            uint32_t points = 0;
+
+            for (uint32_t i = 1; i < size; i++, points++) {
+                Time sentAt = m_window.GetSendTime(i);
+                Time recvAt = m_window.GetRecvTime(i);
+                smoothedDelay = SMOOTH(smoothedDelay, recvAt - sentAt, 9, 1);
+                accumulatedDelayDelta += ((recvAt - prevRecvTime) - (sentAt - prevSendTime));
+                smoothedDelayDelta = SMOOTH(smoothedDelayDelta, accumulatedDelayDelta, 9, 1);
+
+                x[points] = recvAt - baseRecvTime;
+                y[points] = smoothedDelayDelta;
+
+                xSum += recvAt - baseRecvTime;
+                ySum += smoothedDelayDelta;
+
+                prevSendTime = sentAt;
+                prevRecvTime = recvAt;
+            }
+
+            Time xAvg(xSum / points);
+            Time yAvg(ySum / points);
+
+            double numerator = 0.0;
+            double denominator = 0.0;
+
+            for (uint32_t i = 0; i < points; i++) {
+                numerator += ((x[i] - xAvg) * (y[i] - yAvg)).GetDouble();
+                denominator += ((x[i] - xAvg) * (x[i] - xAvg)).GetDouble();
+            }
+            m_trendlineSlope = numerator / denominator;
+
+            // Calculate delay range and average delay, extremes older than their window are forgotten
+            // so that the range follows route and capacity changes
+            delayMin = m_delayMin.Update(params.delayMinWindow, recvTime, smoothedDelay);
+            delayMax = m_delayMax.Update(params.delayMaxWindow, recvTime, smoothedDelay);
+            Time delayAvg = (delayMax + delayMin) / 2;
+
+            // Calculate interval range and target interval
+            if (smoothedDelay <= delayMin * 100 / 97 && m_delayMinInterval > m_recvIntervalAvg) {
+                m_delayMinInterval = SMOOTH(m_delayMinInterval, m_recvIntervalAvg, 95, 5);
+            }
+            if ((smoothedDelay >= delayMax * 97 / 100 && m_delayMaxInterval < m_recvIntervalAvg) || m_lost == 0) {
+                m_delayMaxInterval = SMOOTH(m_delayMaxInterval, m_recvIntervalAvg, 9, 1);
+            }
+            m_targetInterval = (m_delayMaxInterval + m_delayMinInterval) / 2;
+
+            // Loss-based and Delay-based control
+            if (m_lost > 0) {
+                // Lost packets -> Increase interval = Decrease throughput
+                if (m_lost > 10) {
+                    reason = UdpCcController::DECISION_LOSS_HEAVY;
+                    UpdateInterval(m_interval * 100 / 70);
+                } else {
+                    reason = UdpCcController::DECISION_LOSS;
+                    UpdateInterval(m_interval * 100 / (100 - 3 * m_lost));
+                }
+            } else if (params.ecn && m_ce > 0) {
+                // Congestion experienced -> Increase interval = Decrease throughput, once per round trip:
+                // packets sent before the last response do not show its effect yet
+                reason = params.ecnScalable ? UdpCcController::DECISION_CE_SCALABLE : UdpCcController::DECISION_CE;
+                if (sendTime > m_ceResponseTime) {
+                    m_ceResponseTime = recvTime;
+                    if (params.ecnScalable) {
+                        // Scalable response: back off in proportion to the marked fraction, twice the interval when all are marked
+                        BackOff(m_interval * 1000 / (1000 - (int64_t) (m_ecnAlpha * 500)));
+                    } else {
+                        BackOff(m_interval * 100 / 90);
+                    }
+                }
+            } else if (smoothedDelay <= delayMin * 100 / 95) {
+                // Too low congestion -> Decrease interval = Increase throughput
+                reason = UdpCcController::DECISION_BELOW_MIN;
+                UpdateInterval(m_interval * 95 / 100);
+            } else if (smoothedDelay > delayMax * 95 / 100) {
+                // Too high congestion -> Increase interval = Decrease throughput
+                reason = UdpCcController::DECISION_ABOVE_MAX;
+                UpdateInterval(m_interval * 100 / 85);
+            } else {
+                if (smoothedDelay > delayAvg * 100 / 80) {
+                    // Above target delay
+                    reason = UdpCcController::DECISION_HIGH_FLAT;
+                    // Delay increases -> Increase interval = Decrease throughput
+                    if (m_trendlineSlope > 0.05) {
+                        reason = UdpCcController::DECISION_HIGH_RISING_FAST;
+                        UpdateInterval(m_interval * 100 / 95);
+                    } else if (m_trendlineSlope >= -0.01) {
+                        reason = UdpCcController::DECISION_HIGH_RISING;
+                        UpdateInterval(m_interval * 100 / 97);
+                    }
+                    // Delay decreases -> Decrease interval = Increase throughput
+                    if (m_trendlineSlope < -0.10) {
+                        reason = UdpCcController::DECISION_HIGH_FALLING_FAST;
+                        UpdateInterval(m_interval * 96 / 100);
+                    } else if (m_trendlineSlope < -0.05) {
+                        reason = UdpCcController::DECISION_HIGH_FALLING;
+                        UpdateInterval(m_interval * 98 / 100);
+                    }
+                } else if (smoothedDelay < delayAvg * 80 / 100) {
+                    // Below target delay
+                    reason = UdpCcController::DECISION_LOW_FLAT;
+                    // Delay increases -> Increase interval = Decrease throughput
+                    if (m_trendlineSlope > 0.10) {
+                        reason = UdpCcController::DECISION_LOW_RISING_FAST;
+                        UpdateInterval(m_interval * 100 / 95);
+                    } else if (m_trendlineSlope > 0.05) {
+                        reason = UdpCcController::DECISION_LOW_RISING;
+                        UpdateInterval(m_interval * 100 / 97);
+                    }
+                    // Delay decreases -> Decrease interval = Increase throughput
+                    if (m_trendlineSlope < -0.05) {
+                        reason = UdpCcController::DECISION_LOW_FALLING_FAST;
+                        UpdateInterval(m_interval * 96 / 100);
+                    } else if (m_trendlineSlope <= 0.01) {
+                        reason = UdpCcController::DECISION_LOW_FALLING;
+                        UpdateInterval(m_interval * 98 / 100);
+                    }
+                } else {
+                    // Within target delay -> Hold interval = Hold throughput
+                    reason = UdpCcController::DECISION_HOLD;
+                    UpdateInterval(SMOOTH(m_interval, ((m_delayMaxInterval + m_delayMinInterval) / 2) * 100 / 97, 5, 5));
+                }
+            }
+        } else if (m_warm) {
+            // Warm start -> Hold interval until the trendline has enough samples
+            reason = UdpCcController::DECISION_WARM;
+        } else {
+            // Bootstrap stage -> Decrease interval = Increase throughput
+            reason = UdpCcController::DECISION_BOOTSTRAP;
+            UpdateInterval(m_interval * 75 / 100);
+        }
+
+        m_delay = smoothedDelay;
+        m_decisionDelayMin = delayMin;
+        m_decisionDelayMax = delayMax;
+        return reason;
+    }
+
+    UdpCcController::UdpCcController() {
+        NS_LOG_FUNCTION(this);
+        m_decisions = 0;
+        for (uint32_t i = 0; i < DECISION_REASONS; i++) {
+            m_decisionCount[i] = 0;
+            m_decisionDelta[i] = Time(0);
+        }
+        TraceLaw();
+    }
+
+    UdpCcController::~UdpCcController() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    Time UdpCcController::GetInterval(void) const {
+        return m_interval;
+    }
+
+    void UdpCcController::SetState(const UdpCcState &state) {
+        m_law.SetState(GetParams(), state, Simulator::Now());
+        TraceLaw();
+    }
+
+    bool UdpCcController::GetState(UdpCcState &state) const {
+        return m_law.GetState(state);
+    }
+
+    void UdpCcController::OnFeedbackTimeout(double backoff, Time maxInterval) {
+        Time oldInterval = m_law.GetInterval();
+        m_law.OnFeedbackTimeout(backoff, maxInterval, Simulator::Now());
+        TraceLaw();
+        RecordDecision(DECISION_DEADMAN, m_law.m_lastFeedbackSeq, Time(0), m_law.m_delayMin.Get(), m_law.m_delayMax.Get(),
+                       oldInterval, m_law.GetInterval());
+    }
+
+    void UdpCcController::SetIncreaseWeight(double weight) {
+        m_law.SetIncreaseWeight(weight);
+    }
+
+    uint8_t UdpCcController::GetEcnCodepoint(void) const {
+        if (!m_ecn) {
+            return 0;
+        }
+        return m_ecnScalable ? ECN_ECT1 : ECN_ECT0;
+    }
+
+    uint32_t UdpCcController::GetDecisionCount(uint8_t reason) const {
+        NS_ASSERT(reason < DECISION_REASONS);
+        return m_decisionCount[reason];
+    }
+
+    Time UdpCcController::GetDecisionDelta(uint8_t reason) const {
+        NS_ASSERT(reason < DECISION_REASONS);
+        return m_decisionDelta[reason];
+    }
+
+    const char *UdpCcController::GetDecisionName(uint8_t reason) {
+        static const char *names[DECISION_REASONS] = {
+            "bootstrap", "loss_heavy", "loss", "ce_scalable", "ce", "below_min", "above_max",
+            "high_rising_fast", "high_rising", "high_flat", "high_falling", "high_falling_fast",
+            "low_rising_fast", "low_rising", "low_flat", "low_falling", "low_falling_fast", "hold",
+            "deadman", "resume", "warm"
+        };
+        return reason < DECISION_REASONS ? names[reason] : "unknown";
+    }
+
+    UdpCcParams UdpCcController::GetParams(void) const {
+        UdpCcParams params;
+        params.delayMinWindow = m_delayMinWindow;
+        params.delayMaxWindow = m_delayMaxWindow;
+        params.ecn = m_ecn;
+        params.ecnScalable = m_ecnScalable;
+        params.ecnGain = m_ecnGain;
+        return params;
+    }
+
+    void UdpCcController::TraceLaw(void) {
+        m_interval = m_law.m_interval;
+        m_trendlineSlope = m_law.m_trendlineSlope;
+        m_targetInterval = m_law.m_targetInterval;
+        m_lostTrace = m_law.m_lost;
+        m_ceTrace = m_law.m_ce;
+        m_ecnAlpha = m_law.m_ecnAlpha;
+    }
+
+    void UdpCcController::RecordDecision(uint8_t reason, uint32_t seq, Time delay, Time delayMin, Time delayMax,
+                                         Time oldInterval, Time newInterval) {
+        m_decisionCount[reason]++;
+        m_decisionDelta[reason] += newInterval - oldInterval;
+
+        // Only sampled decisions build a record
+        m_decisions++;
+        if (m_decisionSampling == 0 || m_decisions % m_decisionSampling != 0) {
+            return;
+        }
+        UdpCcDecision decision;
+        decision.reason = reason;
+        decision.seq = seq;
+        decision.lost = m_lostTrace;
+        decision.ce = m_ceTrace;
+        decision.trendlineSlope = m_trendlineSlope;
+        decision.delay = delay;
+        decision.delayMin = delayMin;
+        decision.delayMax = delayMax;
+        decision.oldInterval = oldInterval;
+        decision.newInterval = newInterval;
+        m_decisionTrace(decision);
+    }
+
+    void UdpCcController::OnFeedback(uint32_t lost, uint32_t ce, uint32_t seq, Time sendTime, Time recvTime, Time sendInterval) {
+        Time oldInterval = m_law.GetInterval();
+        uint8_t reason = m_law.OnFeedback(GetParams(), lost, ce, seq, sendTime, recvTime, sendInterval);
+        TraceLaw();
+
+        if (m_law.m_resumed) {
+            RecordDecision(DECISION_RESUME, seq, Time(0), m_law.m_delayMin.Get(), m_law.m_delayMax.Get(),
+                           m_law.m_resumedFrom, m_law.m_resumedTo);
+            oldInterval = m_law.m_resumedTo;
+        }
+        RecordDecision(reason, seq, m_law.m_delay, m_law.m_decisionDelayMin, m_law.m_decisionDelayMax,
+                       oldInterval, m_law.GetInterval());
+    }
+
+    TypeId UdpCcStateCache::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::UdpCcStateCache")
+            .SetParent<Object>()
+            .SetGroupName("Internet")
+            .AddConstructor<UdpCcStateCache>()
+        ;
+        return tid;
+    }
+
+    UdpCcStateCache::UdpCcStateCache() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    UdpCcStateCache::~UdpCcStateCache() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    bool UdpCcStateCache::Acquire(Ipv4Address destination, UdpCcState &state) {
+        std::map<Ipv4Address, Entry>::iterator iter = m_entries.find(destination);
+        if (iter == m_entries.end()) {
+            Entry entry;
+            entry.valid = false;
+            entry.flows = 0;
+            iter = m_entries.insert(std::make_pair(destination, entry)).first;
+        }
+        uint32_t flows = iter->second.flows++;
+        if (!iter->second.valid) {
+            return false;
+        }
+
+        // The flows already sending share their rate with the new one
+        state = iter->second.state;
+        if (flows > 0) {
+            state.interval = state.interval * (flows + 1) / flows;
+        }
+        return true;
+    }
+
+    void UdpCcStateCache::Release(Ipv4Address destination) {
+        std::map<Ipv4Address, Entry>::iterator iter = m_entries.find(destination);
+        if (iter != m_entries.end() && iter->second.flows > 0) {
+            iter->second.flows--;
+        }
+    }
+
+    void UdpCcStateCache::Store(Ipv4Address destination, const UdpCcState &state) {
+        std::map<Ipv4Address, Entry>::iterator iter = m_entries.find(destination);
+        if (iter == m_entries.end()) {
+            Entry entry;
+            entry.flows = 0;
+            iter = m_entries.insert(std::make_pair(destination, entry)).first;
+        }
+        iter->second.state = state;
+        iter->second.valid = true;
+    }
+
+    uint32_t UdpCcStateCache::GetSize(void) const {
+        uint32_t size = 0;
+        for (std::map<Ipv4Address, Entry>::const_iterator iter = m_entries.begin(); iter != m_entries.end(); iter++) {
+            size += iter->second.valid;
+        }
+        return size;
+    }
+
+    uint32_t UdpCcStateCache::Load(std::string filename) {
+        NS_LOG_FUNCTION(this << filename);
+        std::ifstream file(filename.c_str());
+        std::string line, address;
+        int64_t values[5];
+        uint32_t count = 0;
+        while (std::getline(file, line)) {
+            std::istringstream entry(line);
+            if (!(entry >> address >> values[0] >> values[1] >> values[2] >> values[3] >> values[4])) {
+                continue; // Blank or malformed line
+            }
+            UdpCcState state;
+            state.interval = NanoSeconds(values[0]);
+            state.delayMin = NanoSeconds(values[1]);
+            state.delayMax = NanoSeconds(values[2]);
+            state.delayMinInterval = NanoSeconds(values[3]);
+            state.delayMaxInterval = NanoSeconds(values[4]);
+            Store(Ipv4Address(address.c_str()), state);
+            count++;
+        }
+        return count;
+    }
+
+    void UdpCcStateCache::Save(std::string filename) const {
+        NS_LOG_FUNCTION(this << filename);
+        std::ofstream file(filename.c_str(), std::ios::trunc);
+        if (!file) {
+            NS_LOG_WARN("Cannot write the state cache to " << filename);
+            return;
+        }
+        // destination interval delayMin delayMax delayMinInterval delayMaxInterval, times in ns
+        for (std::map<Ipv4Address, Entry>::const_iterator iter = m_entries.begin(); iter != m_entries.end(); iter++) {
+            if (!iter->second.valid) {
+                continue;
+            }
+            const UdpCcState &state = iter->second.state;
+            file << iter->first << " " << state.interval.GetNanoSeconds() << " " << state.delayMin.GetNanoSeconds() << " " <<
+                    state.delayMax.GetNanoSeconds() << " " << state.delayMinInterval.GetNanoSeconds() << " " <<
+                    state.delayMaxInterval.GetNanoSeconds() << "\n";
+        }
+    }
+
+} // namespace ns3
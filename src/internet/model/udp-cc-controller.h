@@ -0,0 +1,494 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UDP_CC_CONTROLLER_H
+#define UDP_CC_CONTROLLER_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+
+#include <map>
+#include <string>
+
+#define LIST_SIZE_LOWER_LIMIT 5
+#define LIST_SIZE_UPPER_LIMIT 30
+
+namespace ns3 {
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Running minimum or maximum of the samples within a time window.
+     *
+     * Kathleen Nichols' windowed filter as used by BBR: the best, second best
+     * and third best samples of successive sub-windows are kept, so that the
+     * extreme ages out without storing every sample. A zero window never ages
+     * out and keeps the all-time extreme.
+     */
+    class WindowedFilter {
+    public:
+        /**
+         * \param max true for a running maximum, false for a running minimum
+         * \param initial the value reported before the first sample
+         */
+        WindowedFilter(bool max, Time initial);
+
+        /**
+         * \brief Add a sample
+         * \param window the horizon of the filter
+         * \param now the time of the sample
+         * \param value the sample
+         * \return the extreme within the window
+         */
+        Time Update(Time window, Time now, Time value);
+
+        /**
+         * \return the extreme within the window
+         */
+        Time Get(void) const;
+
+    private:
+        struct Sample {
+            Time time;
+            Time value;
+        };
+
+        bool IsBetter(Time value, Time than) const;
+        void Reset(Time now, Time value);
+
+        bool m_max;
+        Sample m_samples[3]; //!< Best, second best and third best samples
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Learned state of UdpCcController, to warm-start another controller on the same path.
+     */
+    struct UdpCcState {
+        Time interval;
+        Time delayMin;
+        Time delayMax;
+        Time delayMinInterval; //!< Send interval seen at the lowest delays
+        Time delayMaxInterval; //!< Send interval seen at the highest delays
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief One rate decision of UdpCcController: the rule that fired, its inputs and its outcome.
+     */
+    struct UdpCcDecision {
+        uint8_t reason; //!< UdpCcController::DecisionReason of the rule that fired
+        uint32_t seq; //!< Sequence number of the packet that triggered the feedback
+        uint32_t lost; //!< Packets lost since the previous feedback
+        uint32_t ce; //!< CE marks since the previous feedback
+        double trendlineSlope;
+        Time delay; //!< Smoothed one-way delay, 0 in the bootstrap stage
+        Time delayMin;
+        Time delayMax;
+        Time oldInterval;
+        Time newInterval; //!< Interval after the decision, bounds and smoothing applied
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Send and receive times of the latest feedbacks, the input of the trendline.
+     *
+     * A ring of LIST_SIZE_UPPER_LIMIT feedbacks held in place, so that the
+     * windows of many flows fit in one array without allocations.
+     */
+    class TrendlineWindow {
+    public:
+        TrendlineWindow();
+
+        /**
+         * \brief Add the times of a feedback, replacing the oldest one when the window is full
+         * \param sendTime send time of the packet that triggered the feedback
+         * \param recvTime receive time of that packet
+         */
+        void Push(Time sendTime, Time recvTime);
+
+        /**
+         * \return the number of feedbacks in the window
+         */
+        uint32_t GetSize(void) const;
+
+        /**
+         * \param i index of the feedback, 0 for the oldest
+         * \return the send time of the packet of the feedback
+         */
+        Time GetSendTime(uint32_t i) const;
+
+        /**
+         * \param i index of the feedback, 0 for the oldest
+         * \return the receive time of the packet of the feedback
+         */
+        Time GetRecvTime(uint32_t i) const;
+
+    private:
+        Time m_sendTimes[LIST_SIZE_UPPER_LIMIT];
+        Time m_recvTimes[LIST_SIZE_UPPER_LIMIT];
+        uint32_t m_first; //!< Slot of the oldest feedback
+        uint32_t m_size;
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Parameters of UdpCcLaw, the attributes of UdpCcController shared by the flows using them.
+     */
+    struct UdpCcParams {
+        Time delayMinWindow; //!< Horizon of the minimum delay filter, 0 for the all-time minimum
+        Time delayMaxWindow; //!< Horizon of the maximum delay filter, 0 for the all-time maximum
+        bool ecn; //!< Respond to CE feedback
+        bool ecnScalable; //!< Scalable (L4S-style) response to the marked fraction
+        double ecnGain; //!< EWMA gain of the marked fraction estimate
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Control law of UdpCcController with the state of one flow, without attributes or traces.
+     *
+     * Plain data of fixed size, so that UdpMultiClient keeps the laws of all
+     * its flows in one array, while UdpCcController wraps one for a UdpClient
+     * path and traces it.
+     */
+    class UdpCcLaw {
+    public:
+        UdpCcLaw();
+
+        /**
+         * \brief Update the send interval from a receiver feedback, see UdpCcController::OnFeedback
+         * \param params the parameters of the flow
+         * \return the UdpCcController::DecisionReason of the rule that fired
+         */
+        uint8_t OnFeedback(const UdpCcParams &params, uint32_t lost, uint32_t ce, uint32_t seq,
+                           Time sendTime, Time recvTime, Time sendInterval);
+
+        /**
+         * \brief Back off while the feedback is missing, see UdpCcController::OnFeedbackTimeout
+         * \param now the time of the backoff
+         */
+        void OnFeedbackTimeout(double backoff, Time maxInterval, Time now);
+
+        /**
+         * \return the current packet inter-send time
+         */
+        Time GetInterval(void) const;
+
+        void SetIncreaseWeight(double weight);
+
+        /**
+         * \brief Start from the state of an earlier controller, see UdpCcController::SetState
+         * \param now the time the state is taken over
+         */
+        void SetState(const UdpCcParams &params, const UdpCcState &state, Time now);
+
+        bool GetState(UdpCcState &state) const;
+
+    private:
+        friend class UdpCcController; // Traces the state and the outcome of the decisions
+
+        void UpdateInterval(Time newInterval);
+
+        /**
+         * \brief Slow down to an interval at once, without the smoothing of UpdateInterval
+         *
+         * An interval beyond the upper bound is clamped to it rather than ignored,
+         * and the interval never decreases.
+         *
+         * \param newInterval the interval asked for
+         */
+        void BackOff(Time newInterval);
+
+        Time m_interval; //!< Packet inter-send time
+        bool m_deadman; //!< Backing off without feedback
+        bool m_warm; //!< Started from the state of an earlier controller
+        Time m_deadmanInterval; //!< Interval before the backoff
+        Time m_deadmanTime; //!< Time of the last backoff
+        double m_increaseWeight;
+
+        TrendlineWindow m_window;
+
+        double m_trendlineSlope;
+        Time m_recvIntervalAvg;
+        WindowedFilter m_delayMin; //!< Lowest smoothed delay within DelayMinWindow
+        WindowedFilter m_delayMax; //!< Highest smoothed delay within DelayMaxWindow
+        Time m_delayMinInterval;
+        Time m_delayMaxInterval;
+        Time m_targetInterval;
+        uint32_t m_totalLost;
+        uint32_t m_lost; //!< Packets lost since the previous feedback
+
+        uint32_t m_totalCe;
+        uint32_t m_lastFeedbackSeq;
+        Time m_ceResponseTime; //!< Receive time of the feedback behind the last CE response
+        uint32_t m_ce; //!< CE marks since the previous feedback
+        double m_ecnAlpha;
+
+        // Outcome of the last OnFeedback besides the interval
+        Time m_delay; //!< Smoothed one-way delay, 0 in the bootstrap stage
+        Time m_decisionDelayMin;
+        Time m_decisionDelayMax;
+        bool m_resumed; //!< The feedback stepped back from a deadman backoff
+        Time m_resumedFrom; //!< Interval before that step
+        Time m_resumedTo; //!< Interval after that step
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Delay-gradient and loss based rate controller of the UDP cc client.
+     *
+     * The controller is fed with the receiver feedback of one path and
+     * computes the packet inter-send time of that path. The control law
+     * itself is a UdpCcLaw; the controller adds attributes, traces and the
+     * decision statistics.
+     */
+    class UdpCcController : public Object {
+    public:
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        /**
+         * Rule of OnFeedback that decided the new interval. The HIGH and LOW
+         * reasons are the trendline cases above and below the target delay,
+         * FLAT when the slope is within the dead band of the rule. DEADMAN is a
+         * backoff without feedback, RESUME a step back to the interval before it.
+         * WARM holds a warm-started interval in place of the bootstrap ramp.
+         */
+        enum DecisionReason {
+            DECISION_BOOTSTRAP,
+            DECISION_LOSS_HEAVY,
+            DECISION_LOSS,
+            DECISION_CE_SCALABLE,
+            DECISION_CE,
+            DECISION_BELOW_MIN,
+            DECISION_ABOVE_MAX,
+            DECISION_HIGH_RISING_FAST,
+            DECISION_HIGH_RISING,
+            DECISION_HIGH_FLAT,
+            DECISION_HIGH_FALLING,
+            DECISION_HIGH_FALLING_FAST,
+            DECISION_LOW_RISING_FAST,
+            DECISION_LOW_RISING,
+            DECISION_LOW_FLAT,
+            DECISION_LOW_FALLING,
+            DECISION_LOW_FALLING_FAST,
+            DECISION_HOLD,
+            DECISION_DEADMAN,
+            DECISION_RESUME,
+            DECISION_WARM,
+            DECISION_REASONS
+        };
+
+        /**
+         * TracedCallback signature for the rate decisions.
+         *
+         * \param [in] decision the decision
+         */
+        typedef void (* DecisionTracedCallback)(const UdpCcDecision &decision);
+
+        UdpCcController();
+        virtual ~UdpCcController();
+
+        /**
+         * \brief Update the send interval from a receiver feedback
+         * \param lost cumulative number of lost packets reported by the receiver
+         * \param ce cumulative number of CE marked packets reported by the receiver
+         * \param seq sequence number of the packet that triggered the feedback
+         * \param sendTime send time of that packet
+         * \param recvTime receive time of that packet
+         * \param sendInterval send interval in use when that packet was sent
+         */
+        void OnFeedback(uint32_t lost, uint32_t ce, uint32_t seq, Time sendTime, Time recvTime, Time sendInterval);
+
+        /**
+         * \return the current packet inter-send time
+         */
+        Time GetInterval(void) const;
+
+        /**
+         * \brief Back off while the feedback is missing
+         *
+         * Feedback on packets sent after the last backoff brings the interval back
+         * to the one before the first backoff in steps, halving the backoff each time.
+         *
+         * \param backoff factor applied to the interval
+         * \param maxInterval largest interval of the backoff
+         */
+        void OnFeedbackTimeout(double backoff, Time maxInterval);
+
+        /**
+         * \brief Weight applied to rate increases, used to couple several controllers
+         * \param weight share of the increase taken by this controller, in [0, 1]
+         */
+        void SetIncreaseWeight(double weight);
+
+        /**
+         * \brief Start from the state of an earlier controller instead of the bootstrap ramp, before the first feedback
+         * \param state the state
+         */
+        void SetState(const UdpCcState &state);
+
+        /**
+         * \param state set to the current state
+         * \return false while bootstrapping or backing off, when the state is not worth keeping
+         */
+        bool GetState(UdpCcState &state) const;
+
+        /**
+         * \return the ECN codepoint to set on outgoing packets, 0 when ECN is disabled
+         */
+        uint8_t GetEcnCodepoint(void) const;
+
+        /**
+         * \param reason a DecisionReason
+         * \return the number of decisions taken for the reason
+         */
+        uint32_t GetDecisionCount(uint8_t reason) const;
+
+        /**
+         * \param reason a DecisionReason
+         * \return the net interval change of the decisions taken for the reason, positive when they slowed down
+         */
+        Time GetDecisionDelta(uint8_t reason) const;
+
+        /**
+         * \param reason a DecisionReason
+         * \return a short name of the reason
+         */
+        static const char *GetDecisionName(uint8_t reason);
+
+        /**
+         * \return the parameters of the control law, from the attributes
+         */
+        UdpCcParams GetParams(void) const;
+
+    private:
+        /**
+         * \brief Update the traced values from the state of the law
+         */
+        void TraceLaw(void);
+
+        /**
+         * \brief Count a decision, and trace it if it is sampled
+         */
+        void RecordDecision(uint8_t reason, uint32_t seq, Time delay, Time delayMin, Time delayMax,
+                            Time oldInterval, Time newInterval);
+
+        UdpCcLaw m_law;
+
+        TracedValue<Time> m_interval; //!< Packet inter-send time, as in the law
+        TracedValue<double> m_trendlineSlope;
+        TracedValue<Time> m_targetInterval;
+        TracedValue<uint32_t> m_lostTrace;
+        TracedValue<uint32_t> m_ceTrace;
+        TracedValue<double> m_ecnAlpha;
+
+        Time m_delayMinWindow;
+        Time m_delayMaxWindow;
+        bool m_ecn; //!< Mark outgoing packets ECN capable and respond to CE feedback
+        bool m_ecnScalable; //!< Use ECT(1) and a scalable (L4S-style) response to the marked fraction
+        double m_ecnGain; //!< EWMA gain of the marked fraction estimate
+
+        uint32_t m_decisionSampling; //!< Trace every Nth decision, 0 to trace none
+        uint32_t m_decisions;
+        uint32_t m_decisionCount[DECISION_REASONS];
+        Time m_decisionDelta[DECISION_REASONS];
+        TracedCallback<const UdpCcDecision &> m_decisionTrace;
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Controller states per destination, shared by the UdpClient applications of a run.
+     *
+     * A flow starting towards a destination others already send to takes
+     * its share of their rate. The cache can be saved and loaded, so that
+     * the flows of the next run start warm too.
+     */
+    class UdpCcStateCache : public Object {
+    public:
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        UdpCcStateCache();
+        virtual ~UdpCcStateCache();
+
+        /**
+         * \brief Register a flow towards a destination and get its start state
+         * \param destination the destination
+         * \param state set to the start state of the flow
+         * \return false if nothing is known about the destination
+         */
+        bool Acquire(Ipv4Address destination, UdpCcState &state);
+
+        /**
+         * \brief Unregister a flow registered by Acquire
+         * \param destination the destination
+         */
+        void Release(Ipv4Address destination);
+
+        /**
+         * \brief Keep the state of a flow towards a destination
+         * \param destination the destination
+         * \param state the state
+         */
+        void Store(Ipv4Address destination, const UdpCcState &state);
+
+        /**
+         * \return the number of destinations with a state
+         */
+        uint32_t GetSize(void) const;
+
+        /**
+         * \brief Add the states of a file written by Save, a missing file is an empty cache
+         * \param filename the file
+         * \return the number of states read
+         */
+        uint32_t Load(std::string filename);
+
+        /**
+         * \brief Write the states to a text file, one destination per line
+         * \param filename the file
+         */
+        void Save(std::string filename) const;
+
+    private:
+        struct Entry {
+            UdpCcState state;
+            bool valid;
+            uint32_t flows; //!< Flows currently registered
+        };
+
+        std::map<Ipv4Address, Entry> m_entries;
+    };
+
+} // namespace ns3
+
+#endif /* UDP_CC_CONTROLLER_H */
@@ -23,15 +23,18 @@
 #include "ns3/header.h"
 #include "ns3/simulator.h"
 #include "udp-cc-header.h"
+#include <algorithm>
 
 namespace ns3 {
 
     NS_LOG_COMPONENT_DEFINE("UdpCcHeader");
     NS_OBJECT_ENSURE_REGISTERED(UdpCcHeader);
+    NS_OBJECT_ENSURE_REGISTERED(UdpCcFeedbackHeader);
 
     UdpCcHeader::UdpCcHeader() : m_seq(0),
                                  m_ts(Simulator::Now().GetTimeStep()),
-                                 m_interval(0) {
+                                 m_interval(0),
+                                 m_path(0) {
         NS_LOG_FUNCTION(this);
     }
 
@@ -45,6 +48,11 @@ namespace ns3 {
         return m_seq;
     }
 
+    void UdpCcHeader::SetTs(Time ts) {
+        NS_LOG_FUNCTION(this << ts);
+        m_ts = ts.GetTimeStep();
+    }
+
     Time UdpCcHeader::GetTs(void) const {
         NS_LOG_FUNCTION(this);
         return TimeStep(m_ts);
@@ -59,6 +67,14 @@ namespace ns3 {
         return Time(*((int64_t*)&m_interval));
     }
 
+    void UdpCcHeader::SetPath(uint8_t path) {
+        m_path = path;
+    }
+
+    uint8_t UdpCcHeader::GetPath(void) const {
+        return m_path;
+    }
+
     TypeId UdpCcHeader::GetTypeId(void) {
         static TypeId tid = TypeId("ns3::UdpCcHeader")
             .SetParent<Header>()
@@ -74,12 +90,12 @@ namespace ns3 {
 
     void UdpCcHeader::Print(std::ostream &os) const {
         NS_LOG_FUNCTION(this << &os);
-        os << "(seq=" << m_seq << " time=" << TimeStep(m_ts).GetSeconds() << ")";
+        os << "(seq=" << m_seq << " time=" << TimeStep(m_ts).GetSeconds() << " path=" << (uint32_t) m_path << ")";
     }
 
     uint32_t UdpCcHeader::GetSerializedSize(void) const {
         NS_LOG_FUNCTION(this);
-        return 4 + 8 + 8;
+        return 4 + 8 + 8 + 1;
     }
 
     void UdpCcHeader::Serialize(Buffer::Iterator start) const {
@@ -88,6 +104,7 @@ namespace ns3 {
         i.WriteHtonU32(m_seq);
         i.WriteHtonU64(m_ts);
         i.WriteHtonU64(m_interval);
+        i.WriteU8(m_path);
     }
 
     uint32_t UdpCcHeader::Deserialize(Buffer::Iterator start) {
@@ -96,6 +113,100 @@ namespace ns3 {
         m_seq = i.ReadNtohU32();
         m_ts = i.ReadNtohU64();
         m_interval = i.ReadNtohU64();
+        m_path = i.ReadU8();
+        return GetSerializedSize();
+    }
+
+    UdpCcFeedbackHeader::UdpCcFeedbackHeader() : m_seq(0),
+                                                 m_path(0),
+                                                 m_delay(0),
+                                                 m_lost(0),
+                                                 m_ce(0) {
+        NS_LOG_FUNCTION(this);
+    }
+
+    void UdpCcFeedbackHeader::SetSeq(uint32_t seq) {
+        m_seq = seq;
+    }
+
+    uint32_t UdpCcFeedbackHeader::GetSeq(void) const {
+        return m_seq;
+    }
+
+    void UdpCcFeedbackHeader::SetPath(uint8_t path) {
+        m_path = path;
+    }
+
+    uint8_t UdpCcFeedbackHeader::GetPath(void) const {
+        return m_path;
+    }
+
+    void UdpCcFeedbackHeader::SetDelay(Time delay) {
+        m_delay = std::min<int64_t>(std::max<int64_t>(delay.GetNanoSeconds(), 0), 0xffffffff);
+    }
+
+    Time UdpCcFeedbackHeader::GetDelay(void) const {
+        return NanoSeconds(m_delay);
+    }
+
+    void UdpCcFeedbackHeader::SetLost(uint32_t lost) {
+        m_lost = lost;
+    }
+
+    uint32_t UdpCcFeedbackHeader::GetLost(void) const {
+        return m_lost;
+    }
+
+    void UdpCcFeedbackHeader::SetCe(uint32_t ce) {
+        m_ce = ce;
+    }
+
+    uint32_t UdpCcFeedbackHeader::GetCe(void) const {
+        return m_ce;
+    }
+
+    TypeId UdpCcFeedbackHeader::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::UdpCcFeedbackHeader")
+            .SetParent<Header>()
+            .SetGroupName("Internet")
+            .AddConstructor<UdpCcFeedbackHeader>()
+        ;
+        return tid;
+    }
+
+    TypeId UdpCcFeedbackHeader::GetInstanceTypeId(void) const {
+        return GetTypeId();
+    }
+
+    void UdpCcFeedbackHeader::Print(std::ostream &os) const {
+        NS_LOG_FUNCTION(this << &os);
+        os << "(seq=" << m_seq << " path=" << (uint32_t) m_path << " delay=" << m_delay <<
+              "ns lost=" << m_lost << " ce=" << m_ce << ")";
+    }
+
+    uint32_t UdpCcFeedbackHeader::GetSerializedSize(void) const {
+        NS_LOG_FUNCTION(this);
+        return 4 + 1 + 4 + 4 + 4;
+    }
+
+    void UdpCcFeedbackHeader::Serialize(Buffer::Iterator start) const {
+        NS_LOG_FUNCTION(this << &start);
+        Buffer::Iterator i = start;
+        i.WriteHtonU32(m_seq);
+        i.WriteU8(m_path);
+        i.WriteHtonU32(m_delay);
+        i.WriteHtonU32(m_lost);
+        i.WriteHtonU32(m_ce);
+    }
+
+    uint32_t UdpCcFeedbackHeader::Deserialize(Buffer::Iterator start) {
+        NS_LOG_FUNCTION(this << &start);
+        Buffer::Iterator i = start;
+        m_seq = i.ReadNtohU32();
+        m_path = i.ReadU8();
+        m_delay = i.ReadNtohU32();
+        m_lost = i.ReadNtohU32();
+        m_ce = i.ReadNtohU32();
         return GetSerializedSize();
     }
 
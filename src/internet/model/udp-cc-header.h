@@ -24,6 +24,9 @@
 #include "ns3/header.h"
 #include "ns3/nstime.h"
 
+// Time between the feedbacks of a UdpServer path, sent on the first packet after it
+#define UDP_CC_FEEDBACK_PERIOD 5 // ms
+
 namespace ns3 {
     /**
      * \ingroup udpccclientserver
@@ -44,6 +47,11 @@ namespace ns3 {
          */
         uint32_t GetSeq(void) const;
 
+        /**
+         * \param ts the time stamp, set to the current simulation time by default
+         */
+        void SetTs(Time ts);
+
         /**
          * \return the time stamp
          */
@@ -59,6 +67,16 @@ namespace ns3 {
          */
         Time GetInterval(void) const;
 
+        /**
+         * \param path the path (subflow) the packet was sent on
+         */
+        void SetPath(uint8_t path);
+
+        /**
+         * \return the path (subflow) the packet was sent on
+         */
+        uint8_t GetPath(void) const;
+
         /**
          * \brief Get the type ID.
          * \return the object TypeId
@@ -75,8 +93,143 @@ namespace ns3 {
         uint32_t m_seq; //!< Sequence number
         uint64_t m_ts; //!< Timestamp
         uint64_t m_interval;
+        uint8_t m_path; //!< Path (subflow) index
+    };
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Compact receiver feedback of the UDP cc client/server application.
+     *
+     * Carries only what the sender cannot know itself: which packet triggered
+     * the feedback, its one-way delay and the loss and CE counters. The sender
+     * looks up the send time and interval of that packet in its own log.
+     */
+    class UdpCcFeedbackHeader : public Header {
+    public:
+        UdpCcFeedbackHeader();
+
+        /**
+         * \param seq the sequence number of the packet that triggered the feedback
+         */
+        void SetSeq(uint32_t seq);
+
+        /**
+         * \return the sequence number of the packet that triggered the feedback
+         */
+        uint32_t GetSeq(void) const;
+
+        /**
+         * \param path the path (subflow) the packet was sent on
+         */
+        void SetPath(uint8_t path);
+
+        /**
+         * \return the path (subflow) the packet was sent on
+         */
+        uint8_t GetPath(void) const;
+
+        /**
+         * \param delay the one-way delay of the packet, capped at about 4.29 s
+         */
+        void SetDelay(Time delay);
+
+        /**
+         * \return the one-way delay of the packet
+         */
+        Time GetDelay(void) const;
+
+        /**
+         * \param lost cumulative number of lost packets
+         */
+        void SetLost(uint32_t lost);
+
+        /**
+         * \return cumulative number of lost packets
+         */
+        uint32_t GetLost(void) const;
+
+        /**
+         * \param ce cumulative number of CE marked packets
+         */
+        void SetCe(uint32_t ce);
+
+        /**
+         * \return cumulative number of CE marked packets
+         */
+        uint32_t GetCe(void) const;
+
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        virtual TypeId GetInstanceTypeId(void) const;
+        virtual void Print(std::ostream &os) const;
+        virtual uint32_t GetSerializedSize(void) const;
+        virtual void Serialize(Buffer::Iterator start) const;
+        virtual uint32_t Deserialize(Buffer::Iterator start);
+
+    private:
+        uint32_t m_seq; //!< Sequence number of the packet that triggered the feedback
+        uint8_t m_path; //!< Path (subflow) index
+        uint32_t m_delay; //!< One-way delay in nanoseconds
+        uint32_t m_lost;
+        uint32_t m_ce;
     };
 
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Receiver feedback of the UDP cc client/server application in its full
+     * form, the payload of a feedback packet without CompactFeedback.
+     */
+    typedef union {
+        uint8_t buf[16];
+        struct {
+            int64_t recvTime;
+            uint32_t lost;
+            uint32_t ce;
+        };
+    } message_t;
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief NACK block appended to the feedback in reliable mode, followed by count nack_range_t.
+     */
+    typedef struct {
+        uint32_t cumAck;
+        uint32_t receivedEnd;
+        uint32_t count;
+    } nack_header_t;
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Range of missing sequence numbers of a NACK block.
+     */
+    typedef struct {
+        uint32_t start;
+        uint32_t length;
+    } nack_range_t;
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Frame information at the start of the payload in frame mode.
+     */
+    typedef union {
+        uint8_t buf[16];
+        struct {
+            int64_t captureTime;
+            uint32_t frameId;
+            uint16_t index;
+            uint16_t count;
+        };
+    } frame_t;
+
 } // namespace ns3
 
 #endif /* UDP_CC_HEADER_H */
@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "udp-cc-header.h"
+#include "udp-multi-client.h"
+#include <algorithm>
+
+namespace ns3 {
+
+    NS_LOG_COMPONENT_DEFINE("UdpMultiClient");
+    NS_OBJECT_ENSURE_REGISTERED(UdpMultiClient);
+
+    TypeId UdpMultiClient::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::UdpMultiClient")
+            .SetParent<Application>()
+            .SetGroupName("Internet")
+            .AddConstructor<UdpMultiClient>()
+            .AddAttribute("PacketSize",
+                          "Size of packets generated, including the header carrying the sequence number and the time stamp.",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&UdpMultiClient::m_size),
+                          MakeUintegerChecker<uint32_t>(21,65507))
+            .AddAttribute("Tick",
+                          "The resolution of the timer wheel holding the send times of the flows",
+                          TimeValue(MicroSeconds(50)),
+                          MakeTimeAccessor(&UdpMultiClient::m_tick),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("Slots",
+                          "The number of slots of the timer wheel, later send times wait in the last slot",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&UdpMultiClient::m_slots),
+                          MakeUintegerChecker<uint32_t>(2))
+        ;
+        return tid;
+    }
+
+    UdpMultiClient::UdpMultiClient() {
+        NS_LOG_FUNCTION(this);
+        m_running = false;
+        m_wheelSlot = 0;
+        m_wheelTime = 0;
+        m_wheelCount = 0;
+    }
+
+    UdpMultiClient::~UdpMultiClient() {
+        NS_LOG_FUNCTION(this);
+    }
+
+    uint32_t UdpMultiClient::AddFlow(Address ip, uint16_t port, uint32_t maxPackets) {
+        NS_LOG_FUNCTION(this << ip << port << maxPackets);
+        NS_ASSERT_MSG(Ipv4Address::IsMatchingType(ip), "Flows need an IPv4 address: " << ip);
+        Address peer = InetSocketAddress(Ipv4Address::ConvertFrom(ip), port);
+        NS_ASSERT_MSG(m_flowIndex.find(peer) == m_flowIndex.end(), "Flows need distinct server ports");
+
+        uint32_t flow = m_peers.size();
+        m_peers.push_back(peer);
+        m_maxPackets.push_back(maxPackets);
+        m_sent.push_back(0);
+        m_nextSend.push_back(Simulator::Now().GetTimeStep());
+        m_laws.push_back(UdpCcLaw());
+        m_interval.push_back(m_laws.back().GetInterval().GetTimeStep());
+        m_flowIndex[peer] = flow;
+
+        if (m_running && maxPackets > 0) {
+            // An idle wheel restarts from now
+            if (m_wheelCount == 0) {
+                m_wheelTime = Simulator::Now().GetTimeStep();
+            }
+            Insert(flow);
+            ScheduleTick();
+        }
+        return flow;
+    }
+
+    uint32_t UdpMultiClient::GetFlowCount(void) const {
+        return m_peers.size();
+    }
+
+    uint32_t UdpMultiClient::GetSent(uint32_t flow) const {
+        NS_ASSERT(flow < m_sent.size());
+        return m_sent[flow];
+    }
+
+    Time UdpMultiClient::GetInterval(uint32_t flow) const {
+        NS_ASSERT(flow < m_laws.size());
+        return m_laws[flow].GetInterval();
+    }
+
+    void UdpMultiClient::DoDispose(void) {
+        NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_tickEvent);
+        if (m_socket != 0) {
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+            m_socket->Close();
+            m_socket = 0;
+        }
+        m_wheel.clear();
+        m_laws.clear();
+        m_flowIndex.clear();
+        Application::DoDispose();
+    }
+
+    void UdpMultiClient::StartApplication(void) {
+        NS_LOG_FUNCTION(this);
+
+        if (m_socket == 0) {
+            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+            m_socket = Socket::CreateSocket(GetNode(), tid);
+            if (m_socket->Bind() == -1) {
+                NS_FATAL_ERROR("Failed to bind socket");
+            }
+        }
+        m_socket->SetRecvCallback(MakeCallback(&UdpMultiClient::HandleRead, this));
+        // One controller reads the attributes shared by the control laws of all flows
+        Ptr<UdpCcController> controller = CreateObject<UdpCcController>();
+        m_params = controller->GetParams();
+        if (controller->GetEcnCodepoint() != 0) {
+            m_socket->SetIpTos(controller->GetEcnCodepoint());
+        }
+
+        m_wheel.assign(m_slots, std::vector<uint32_t>());
+        m_wheelSlot = 0;
+        m_wheelTime = Simulator::Now().GetTimeStep();
+        m_wheelCount = 0;
+        m_running = true;
+        for (uint32_t flow = 0; flow < m_peers.size(); flow++) {
+            if (m_sent[flow] < m_maxPackets[flow]) {
+                m_nextSend[flow] = std::max(m_nextSend[flow], m_wheelTime);
+                Insert(flow);
+            }
+        }
+        ScheduleTick();
+    }
+
+    void UdpMultiClient::StopApplication(void) {
+        NS_LOG_FUNCTION(this);
+        m_running = false;
+        Simulator::Cancel(m_tickEvent);
+        if (m_socket != 0) {
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+        }
+    }
+
+    void UdpMultiClient::Insert(uint32_t flow) {
+        // Rounded up, so that no flow sends before its time
+        int64_t tick = m_tick.GetTimeStep();
+        int64_t ticks = (m_nextSend[flow] - m_wheelTime + tick - 1) / tick;
+        ticks = std::max<int64_t>(1, std::min<int64_t>(ticks, m_slots - 1));
+        m_wheel[(m_wheelSlot + ticks) % m_slots].push_back(flow);
+        m_wheelCount++;
+    }
+
+    void UdpMultiClient::ScheduleTick(void) {
+        if (m_wheelCount == 0 || !m_tickEvent.IsExpired()) {
+            return;
+        }
+
+        int64_t now = Simulator::Now().GetTimeStep();
+        uint32_t ticks = 1;
+        while (m_wheel[(m_wheelSlot + ticks) % m_slots].empty()) {
+            ticks++;
+        }
+        m_wheelSlot = (m_wheelSlot + ticks) % m_slots;
+        m_wheelTime += ticks * m_tick.GetTimeStep();
+        m_tickEvent = Simulator::Schedule(TimeStep(std::max<int64_t>(m_wheelTime - now, 0)), &UdpMultiClient::Tick, this);
+    }
+
+    void UdpMultiClient::Tick(void) {
+        NS_LOG_FUNCTION(this);
+        int64_t now = Simulator::Now().GetTimeStep();
+        std::vector<uint32_t> due;
+        due.swap(m_wheel[m_wheelSlot]);
+        m_wheelCount -= due.size();
+
+        for (std::vector<uint32_t>::iterator iter = due.begin(); iter != due.end(); iter++) {
+            uint32_t flow = *iter;
+            if (m_nextSend[flow] > now) {
+                Insert(flow); // Beyond the horizon of the wheel when inserted
+                continue;
+            }
+
+            Send(flow);
+            if (m_sent[flow] < m_maxPackets[flow]) {
+                // Keeps the long-term rate of the flow despite the rounding to ticks
+                m_nextSend[flow] = std::max(m_nextSend[flow] + m_interval[flow], now);
+                Insert(flow);
+            }
+        }
+
+        // Flows are always inserted at least one tick ahead, so the buffer of the slot is kept for its next round
+        due.clear();
+        m_wheel[m_wheelSlot].swap(due);
+        ScheduleTick();
+    }
+
+    void UdpMultiClient::Send(uint32_t flow) {
+        UdpCcHeader header;
+        header.SetSeq(m_sent[flow]);
+        header.SetInterval(TimeStep(m_interval[flow]));
+        Ptr<Packet> p = Create<Packet>(m_size - header.GetSerializedSize());
+        p->AddHeader(header);
+
+        if (m_socket->SendTo(p, 0, m_peers[flow]) >= 0) {
+            m_sent[flow]++;
+        } else {
+            NS_LOG_INFO("Error while sending " << m_size << " bytes of flow " << flow);
+        }
+    }
+
+    void UdpMultiClient::HandleRead(Ptr<Socket> socket) {
+        NS_LOG_FUNCTION(this << socket);
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from))) {
+            std::map<Address, uint32_t>::iterator iter = m_flowIndex.find(from);
+            if (iter == m_flowIndex.end()) {
+                continue;
+            }
+            uint32_t flow = iter->second;
+
+            message_t msg;
+            UdpCcHeader header;
+            packet->RemoveHeader(header);
+            packet->CopyData(msg.buf, 16);
+            m_laws[flow].OnFeedback(m_params, msg.lost, msg.ce, header.GetSeq(), header.GetTs(),
+                                    Time(msg.recvTime), header.GetInterval());
+            m_interval[flow] = m_laws[flow].GetInterval().GetTimeStep();
+        }
+    }
+
+} // namespace ns3
@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UDP_MULTI_CLIENT_H
+#define UDP_MULTI_CLIENT_H
+
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/address.h"
+#include "ns3/udp-cc-controller.h"
+
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+    class Socket;
+
+    /**
+     * \ingroup udpccclientserver
+     *
+     * \brief Drives many UDP cc flows from one node with a single socket.
+     *
+     * Each flow sends the same packets as a UdpClient to its own UdpServer and
+     * is paced by the control law of UdpCcController. The state of the flows
+     * (schedule, counters, control law with its trendline window) is kept by
+     * value in contiguous arrays indexed by flow, without an object or a heap
+     * allocation per flow, and a timer wheel holds the send times of all flows,
+     * so that the application costs one pending simulator event whatever the
+     * number of flows. The control laws are only touched when feedback arrives.
+     * The attributes of UdpCcController apply to all flows.
+     *
+     * Feedback is matched to its flow by the server's address and port, so
+     * every flow needs its own server port. Only the full feedback format of
+     * UdpServer (not CompactFeedback) is understood.
+     */
+    class UdpMultiClient : public Application {
+    public:
+        /**
+         * \brief Get the type ID.
+         * \return the object TypeId
+         */
+        static TypeId GetTypeId(void);
+
+        UdpMultiClient();
+        virtual ~UdpMultiClient();
+
+        /**
+         * \brief Add a flow, which starts sending right away if the application is running
+         * \param ip IPv4 address of the server
+         * \param port port of the server
+         * \param maxPackets the number of packets the flow sends
+         * \return the flow index
+         */
+        uint32_t AddFlow(Address ip, uint16_t port, uint32_t maxPackets);
+
+        /**
+         * \return the number of flows
+         */
+        uint32_t GetFlowCount(void) const;
+
+        /**
+         * \param flow the flow index
+         * \return the number of packets sent by the flow
+         */
+        uint32_t GetSent(uint32_t flow) const;
+
+        /**
+         * \param flow the flow index
+         * \return the current packet inter-send time of the flow
+         */
+        Time GetInterval(uint32_t flow) const;
+
+    protected:
+        virtual void DoDispose(void);
+
+    private:
+        virtual void StartApplication(void);
+        virtual void StopApplication(void);
+
+        /**
+         * \brief Put a flow in the slot of its next send time, at least one tick ahead
+         * \param flow the flow index
+         */
+        void Insert(uint32_t flow);
+
+        /**
+         * \brief Schedule the event of the next slot holding flows, unless one is pending
+         */
+        void ScheduleTick(void);
+
+        /**
+         * \brief Send a packet on every flow of the current slot and reinsert them
+         */
+        void Tick(void);
+
+        /**
+         * \brief Send a packet of a flow
+         * \param flow the flow index
+         */
+        void Send(uint32_t flow);
+
+        /**
+         * \brief Handle the feedback of the servers
+         * \param socket the socket the feedback was received to
+         */
+        void HandleRead(Ptr<Socket> socket);
+
+        uint32_t m_size; //!< Size of the sent packets (including the UdpCcHeader)
+        Time m_tick; //!< Resolution of the timer wheel
+        uint32_t m_slots; //!< Number of slots of the timer wheel
+
+        Ptr<Socket> m_socket;
+        EventId m_tickEvent;
+        bool m_running;
+
+        std::vector< std::vector<uint32_t> > m_wheel; //!< Flows by the slot of their next send time
+        uint32_t m_wheelSlot; //!< Slot of the pending (or last) tick
+        int64_t m_wheelTime; //!< Time step of the pending (or last) tick
+        uint32_t m_wheelCount; //!< Number of flows in the wheel
+
+        // Per-flow state, one entry per flow in each array
+        std::vector<Address> m_peers;
+        std::vector<uint32_t> m_maxPackets;
+        std::vector<uint32_t> m_sent;
+        std::vector<int64_t> m_nextSend; //!< Time steps
+        std::vector<int64_t> m_interval; //!< Time steps, copied from the control law on feedback
+        std::vector<UdpCcLaw> m_laws;
+
+        UdpCcParams m_params; //!< Parameters of the control laws, from the UdpCcController attributes
+
+        std::map<Address, uint32_t> m_flowIndex; //!< Flow by server address and port
+    };
+
+} // namespace ns3
+
+#endif /* UDP_MULTI_CLIENT_H */
@@ -0,0 +1,67 @@
+import argparse
+import struct
+
+# Reader of the flight recorder dumps written by PersonalProject --flight_recorder=<packets>.
+# Prints the packets of every dump with their queueing at each hop, and the hop where most of
+# the delay of the dump built up, e.g.
+#   python3 util/flight.py flight.bin
+#   python3 util/flight.py flight.bin --row=3 --summary
+
+MAX_HOPS = 8
+HEADER = struct.Struct("<4sdIBI")
+HOP = struct.Struct("<Hqq")
+RECORD = struct.Struct("<IIHBBqq" + "Hqq" * MAX_HOPS)
+REASONS = ["end", "at", "trigger"]
+
+parser = argparse.ArgumentParser()
+parser.add_argument("file")
+parser.add_argument("--row", type=int, help="Only the dumps of this flow")
+parser.add_argument("--summary", action="store_true", help="Only the per-hop summary of each dump")
+args = parser.parse_args()
+
+
+def hop_name(hop):
+    # Link index of the topology file, > from its first to its second node, < the other way
+    return "L%d%s" % (hop // 2, ">" if hop % 2 == 0 else "<")
+
+
+def ms(ns):
+    return ns / 1e6
+
+
+with open(args.file, "rb") as dump_file:
+    data = dump_file.read()
+
+offset = 0
+while offset + HEADER.size <= len(data):
+    magic, time, row, reason, count = HEADER.unpack_from(data, offset)
+    if magic != b"NFLT":
+        raise SystemExit("corrupt dump at byte %d" % offset)
+    offset += HEADER.size
+    records = [RECORD.unpack_from(data, offset + i * RECORD.size) for i in range(count)]
+    offset += count * RECORD.size
+    if args.row is not None and row != args.row:
+        continue
+
+    reason = REASONS[reason] if reason < len(REASONS) else str(reason)
+    print("Flow %d: %d packets dumped at %.6f s (%s)" % (row, count, time, reason))
+    queueing = {}
+    for record in records:
+        packet_id, seq, size, path, hops, tx, rx = record[:7]
+        hop_fields = [record[7 + 3 * i:10 + 3 * i] for i in range(hops)]
+        for hop, enqueue, dequeue in hop_fields:
+            if dequeue >= 0:
+                total, packets = queueing.get(hop, (0, 0))
+                queueing[hop] = (total + dequeue - enqueue, packets + 1)
+        if args.summary:
+            continue
+        delay = "%9.3f ms" % ms(rx - tx) if rx >= 0 else "     lost"
+        path_hops = " ".join("%s %.3f" % (hop_name(hop), ms(dequeue - enqueue)) if dequeue >= 0 else "%s drop" % hop_name(hop)
+                             for hop, enqueue, dequeue in hop_fields)
+        print("  %8d seq %8d path %d %5d B  tx %.6f s %s  %s" % (packet_id, seq, path, size, tx / 1e9, delay, path_hops))
+
+    if queueing:
+        worst = max(queueing, key=lambda hop: queueing[hop][0])
+        print("  Queueing per hop: " + ", ".join("%s %.3f ms avg" % (hop_name(hop), ms(total / packets))
+                                               for hop, (total, packets) in sorted(queueing.items())) +
+              "; most at %s" % hop_name(worst))
@@ -0,0 +1,63 @@
+import argparse
+import random
+
+# Generates a topo_file/flow_file pair.
+#   ring: switches form a ring with chords, each switch connects the same number of hosts
+#         (large scenarios to measure the setup cost)
+#   dumbbell: pairs of hosts on both sides of one bottleneck link, mixed TCP/UDP flows
+#         (regression scenarios of util/regress.py)
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--shape", choices=["ring", "dumbbell"], default="ring")
+parser.add_argument("--nodes", type=int, default=1000, help="ring: number of nodes")
+parser.add_argument("--switches", type=int, default=40, help="ring: number of switches")
+parser.add_argument("--flows", type=int, default=200, help="ring: number of flows")
+parser.add_argument("--pairs", type=int, default=4, help="dumbbell: number of sender/receiver pairs, one flow each")
+parser.add_argument("--udp", type=int, default=2, help="dumbbell: number of UDP flows, the others are TCP")
+parser.add_argument("--bottleneck", default="10Mbps", help="dumbbell: rate of the bottleneck link")
+parser.add_argument("--delay", default="20ms", help="dumbbell: delay of the bottleneck link")
+parser.add_argument("--seed", type=int, default=1)
+parser.add_argument("--topo", default="large_topo.txt")
+parser.add_argument("--flow", default="large_flow.txt")
+args = parser.parse_args()
+
+random.seed(args.seed)
+links = []
+flows = []
+
+if args.shape == "ring":
+    switches = list(range(args.switches))
+    hosts = list(range(args.switches, args.nodes))
+    for s in switches:
+        links.append((s, (s + 1) % args.switches, "100Mbps", "1ms"))
+    for s in switches[:args.switches // 2]:
+        links.append((s, s + args.switches // 2, "100Mbps", "2ms"))
+    for i, h in enumerate(hosts):
+        links.append((h, switches[i % args.switches], "10Mbps", "100us"))
+    for i in range(args.flows):
+        src, dst = random.sample(hosts, 2)
+        flows.append(("TCP" if i % 2 == 0 else "UDP", src, dst, 0.1 * (i % 10)))
+    nodes = args.nodes
+else:
+    # Switches 0 and 1 on both ends of the bottleneck, senders 2.., receivers after them
+    switches = [0, 1]
+    links.append((0, 1, args.bottleneck, args.delay))
+    for i in range(args.pairs):
+        sender, receiver = 2 + i, 2 + args.pairs + i
+        links.append((sender, 0, "100Mbps", "1ms"))
+        links.append((receiver, 1, "100Mbps", "1ms"))
+        # Staggered starts, UDP flows interleaved with the TCP flows
+        kind = "UDP" if i * args.udp // args.pairs != (i + 1) * args.udp // args.pairs else "TCP"
+        flows.append((kind, sender, receiver, 0.5 * i))
+    nodes = 2 + 2 * args.pairs
+
+with open(args.topo, "w") as topo:
+    topo.write("%d %d %d\n" % (nodes, len(switches), len(links)))
+    topo.write(" ".join(str(s) for s in switches) + "\n")
+    for link in links:
+        topo.write("%d %d %s %s\n" % link)
+
+with open(args.flow, "w") as flow:
+    flow.write("%d\n" % len(flows))
+    for i, (kind, src, dst, start) in enumerate(flows):
+        flow.write("%s %d %d %d 500000000 %.1f\n" % (kind, src, dst, 10000 + i, start))
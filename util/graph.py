@@ -7,17 +7,20 @@ data = {
     "trendline": {},
     "interval": {},
     "lost": {},
-    "target": {}
+    "target": {},
+    "ce": {}
 }
 
 with open("log.out") as log:
     for line in log:
         tokens = line.split(" ")
         if len(tokens) >= 6:
-            if "P)" in tokens[0]:
-                continue
+            if tokens[0].startswith("("):
+                continue  # Report lines, e.g. (UDP), (LINK)
             timestamp = float(tokens[0])
             label = tokens[3]
+            if label not in data:
+                continue  # e.g. decision lines of --decision_log
             flow = tokens[4]
             value = float(tokens[5][:-1]) if label == "trendline" else int(tokens[5])
             if flow not in data[label]:
@@ -39,7 +42,7 @@ for flow in data["delay"].keys():
 
 
 plt.figure(figsize=(18, 12))
-fig_len = 6
+fig_len = 7
 show_legend = False
 end = 100
 
@@ -102,5 +105,14 @@ plt.ylabel("Target Interval (microsec)")
 if show_legend:
     plt.legend(data["target"].keys())
 
+plt.subplot(fig_len, 1, 7)
+for flow, flow_data in data["ce"].items():
+    plt.plot(flow_data[0], flow_data[1])
+plt.xlim(left=0, right=end)
+plt.xlabel("Time (sec)")
+plt.ylabel("CE marks")
+if show_legend:
+    plt.legend(data["ce"].keys())
+
 plt.tight_layout()
 plt.savefig("fig.png", dpi=300)
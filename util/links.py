@@ -0,0 +1,56 @@
+import argparse
+import struct
+
+# Reader of the link samples written by PersonalProject --link_stats=1 --link_trace=<file>.
+# Prints the per-link averages over the run, or the samples of one link, e.g.
+#   python3 util/links.py links.bin
+#   python3 util/links.py links.bin --hop=3
+
+HEADER = struct.Struct("<4sdH")
+RECORD = struct.Struct("<HIIIIff")
+
+parser = argparse.ArgumentParser()
+parser.add_argument("file")
+parser.add_argument("--hop", type=int, help="Print the samples of this link direction (link index * 2 + side)")
+args = parser.parse_args()
+
+
+def hop_name(hop):
+    # Link index of the topology file, > from its first to its second node, < the other way
+    return "L%d%s" % (hop // 2, ">" if hop % 2 == 0 else "<")
+
+
+with open(args.file, "rb") as trace_file:
+    data = trace_file.read()
+
+totals = {}
+samples = 0
+offset = 0
+if args.hop is not None:
+    print("%10s %8s %10s %8s %6s %10s %6s" % ("time(s)", "queue", "bytes", "device", "drops", "sojourn", "util"))
+while offset + HEADER.size <= len(data):
+    magic, time, count = HEADER.unpack_from(data, offset)
+    if magic != b"NLNK":
+        raise SystemExit("corrupt trace at byte %d" % offset)
+    offset += HEADER.size
+    samples += 1
+    for i in range(count):
+        hop, packets, size, device, drops, sojourn, utilization = RECORD.unpack_from(data, offset + i * RECORD.size)
+        if hop == args.hop:
+            print("%10.3f %8d %10d %8d %6d %10.3f %5.1f%%" % (time, packets, size, device, drops, sojourn, utilization * 100))
+        total = totals.setdefault(hop, [0, 0, 0, 0.0, 0.0])
+        total[0] += packets + device
+        total[1] = max(total[1], packets + device)
+        total[2] += drops
+        total[3] += sojourn
+        total[4] += utilization
+    offset += count * RECORD.size
+
+if args.hop is None and samples > 0:
+    # Averages over the samples, the sojourn of idle samples counts as 0
+    print("%6s %10s %8s %8s %12s %6s" % ("link", "queue avg", "max", "drops", "sojourn(ms)", "util"))
+    for hop, (queue, queue_max, drops, sojourn, utilization) in sorted(totals.items(), key=lambda item: -item[1][4]):
+        if utilization == 0 and queue_max == 0:
+            continue
+        print("%6s %10.1f %8d %8d %12.3f %5.1f%%" % (hop_name(hop), queue / samples, queue_max, drops,
+                                                   sojourn / samples, utilization / samples * 100))
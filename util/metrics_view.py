@@ -0,0 +1,52 @@
+import argparse
+import os
+import shutil
+import socket
+import struct
+
+# Terminal viewer of the live metrics published by PersonalProject --metrics_socket=<path>.
+# Start the viewer first, it owns the socket.
+
+HEADER = struct.Struct("<4sdHB")
+RECORD = struct.Struct("<IBfffI")
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--socket", default="/tmp/netp-metrics.sock")
+parser.add_argument("--sort", choices=["row", "thr"], default="row")
+args = parser.parse_args()
+
+if os.path.exists(args.socket):
+    os.unlink(args.socket)
+sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+sock.bind(args.socket)
+print("Waiting for metrics on %s" % args.socket)
+
+flows = []
+try:
+    while True:
+        data = sock.recv(1 << 16)
+        magic, time, count, last = HEADER.unpack_from(data)
+        if magic != b"NETP":
+            continue
+        for i in range(count):
+            flows.append(RECORD.unpack_from(data, HEADER.size + i * RECORD.size))
+        if not last:
+            continue
+
+        if args.sort == "thr":
+            flows.sort(key=lambda flow: -flow[2])
+        udp = [flow for flow in flows if flow[1]]
+        lines = shutil.get_terminal_size().lines - 4
+        out = ["\033[H\033[J%.1f s  %d flows (%d udp)  total %.0f Kbps" % (time, len(flows), len(udp), sum(flow[2] for flow in flows)),
+               "%6s %4s %12s %10s %12s %8s" % ("flow", "type", "thr(Kbps)", "delay(ms)", "interval(us)", "lost")]
+        for row, is_udp, thr, delay, interval, lost in flows[:lines]:
+            if is_udp:
+                out.append("%6d %4s %12.0f %10.2f %12.0f %8d" % (row, "udp", thr, delay, interval, lost))
+            else:
+                out.append("%6d %4s %12.0f %10s %12s %8s" % (row, "tcp", thr, "-", "-", "-"))
+        print("\n".join(out), flush=True)
+        flows = []
+except KeyboardInterrupt:
+    pass
+finally:
+    os.unlink(args.socket)
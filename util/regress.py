@@ -0,0 +1,197 @@
+import argparse
+import json
+import math
+import os
+import re
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+# Performance regression suite of PersonalProject
+#
+# Runs every scenario, computes its metrics from the (UDP)/(TCP) report lines and
+# compares them against util/regress_baseline.json. The project is expected in scratch/.PP,
+# as for run.sh, e.g.
+#   python3 util/regress.py              compare against the baselines
+#   python3 util/regress.py --update     store the metrics of this run as the baselines
+# A scenario or metric without a baseline fails the run until its baseline is stored with --update.
+
+script_path = os.path.dirname(os.path.abspath(__file__))
+project_path = os.path.dirname(script_path)
+
+# Scenario name, flow file, topology file, simulation time (s)
+scenarios = [
+    ("simple", "simple_flow.txt", "simple_topo.txt", 100),
+    ("complicated", "complicated_flow.txt", "complicated_topo.txt", 100),
+    ("dumbbell4", "dumbbell4_flow.txt", "dumbbell4_topo.txt", 60),
+    ("dumbbell8", "dumbbell8_flow.txt", "dumbbell8_topo.txt", 60),
+    ("dumbbell16", "dumbbell16_flow.txt", "dumbbell16_topo.txt", 60),
+]
+
+# Metric name, description, direction of a regression and default relative tolerance
+#   "lower": a decrease beyond the tolerance fails, "higher": an increase fails, "both": any change fails
+metrics = [
+    ("udp_throughput", "UDP throughput (Kbps)", "lower", 0.05),
+    ("tcp_throughput", "TCP throughput (Kbps)", "lower", 0.05),
+    ("delay_p99", "Max UDP P99 delay (ms)", "higher", 0.10),
+    ("loss_rate", "UDP loss rate", "higher", 0.10),
+    ("jain_fairness", "Jain fairness of UDP", "lower", 0.02),
+    ("share_ratio", "UDP/TCP per-flow share", "both", 0.15),
+]
+
+# Absolute slack below which changes are ignored, so that metrics near zero do not flap
+slack = {
+    "udp_throughput": 1.0,
+    "tcp_throughput": 1.0,
+    "delay_p99": 0.5,
+    "loss_rate": 0.0005,
+    "jain_fairness": 0.005,
+    "share_ratio": 0.02,
+}
+
+udp_throughput_re = re.compile(r"^\(UDP\)(\d+): Throughput ([-\d.e+]+) Kbps")
+udp_p99_re = re.compile(r"^\(UDP\)(\d+): Delay P99  ([-\d.e+]+) ms")
+udp_lost_re = re.compile(r"^\(UDP\)(\d+): Lost       (\d+) of (\d+) packets")
+tcp_throughput_re = re.compile(r"^\(TCP\)(\d+): Throughput ([-\d.e+]+) Kbps")
+
+
+def run_scenario(ns3_path, scenario, extra):
+    name, flow_file, topo_file, sim_time = scenario
+    data_path = os.path.relpath(os.path.join(project_path, "data"), ns3_path)
+    arguments = "scratch/PersonalProject --flow_file=%s --topo_file=%s --sim_time=%d --delay_percentiles=1 %s" % (
+        os.path.join(data_path, flow_file), os.path.join(data_path, topo_file), sim_time, extra)
+    result = subprocess.run(["./waf", "--run-no-build", arguments], cwd=ns3_path,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr[-2000:])
+        raise RuntimeError("%s: exited with %d" % (name, result.returncode))
+    return parse_report(result.stderr.splitlines())
+
+
+def parse_report(lines):
+    udp, tcp, p99, lost, sent = {}, {}, {}, 0, 0
+    for line in lines:
+        match = udp_throughput_re.match(line)
+        if match:
+            udp[match.group(1)] = float(match.group(2))
+            continue
+        match = udp_p99_re.match(line)
+        if match:
+            p99[match.group(1)] = float(match.group(2))
+            continue
+        match = udp_lost_re.match(line)
+        if match:
+            lost += int(match.group(2))
+            sent += int(match.group(3))
+            continue
+        match = tcp_throughput_re.match(line)
+        if match:
+            tcp[match.group(1)] = float(match.group(2))
+
+    udp_values = list(udp.values())
+    tcp_values = list(tcp.values())
+    result = {
+        "udp_throughput": sum(udp_values),
+        "tcp_throughput": sum(tcp_values),
+        "delay_p99": max(p99.values()) if p99 else 0.0,
+        "loss_rate": lost / sent if sent > 0 else 0.0,
+    }
+    # Jain's index (sum x)^2 / (n sum x^2): 1 when all UDP flows get the same throughput, 1/n when one gets all
+    square_sum = sum(x * x for x in udp_values)
+    result["jain_fairness"] = sum(udp_values) ** 2 / (len(udp_values) * square_sum) if square_sum > 0 else 1.0
+    # Mean UDP flow throughput over mean TCP flow throughput, 1 is an equal share (TCP-friendly)
+    if udp_values and tcp_values and sum(tcp_values) > 0:
+        result["share_ratio"] = (sum(udp_values) / len(udp_values)) / (sum(tcp_values) / len(tcp_values))
+    return result
+
+
+def compare(metric, value, baseline, tolerance):
+    name, _, direction, _ = metric
+    change = value - baseline
+    if abs(change) <= max(abs(baseline) * tolerance, slack[name]):
+        return "ok"
+    if direction == "both" or (direction == "lower") == (change < 0):
+        return "FAIL"
+    return "better"
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--ns3", default=os.path.normpath(os.path.join(project_path, "..", "..")),
+                        help="ns-3 root directory (default: two levels above the project, scratch/.PP)")
+    parser.add_argument("--baseline", default=os.path.join(script_path, "regress_baseline.json"))
+    parser.add_argument("--scenario", action="append", help="Run only the named scenarios")
+    parser.add_argument("--tolerance", action="append", default=[], metavar="METRIC=VALUE",
+                        help="Override the relative tolerance of a metric, e.g. delay_p99=0.2")
+    parser.add_argument("--args", default="", help="Extra PersonalProject arguments for every scenario")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("--update", action="store_true", help="Store the metrics of this run as the baselines")
+    parser.add_argument("--no-build", action="store_true")
+    args = parser.parse_args()
+
+    tolerances = dict((metric[0], metric[3]) for metric in metrics)
+    for item in args.tolerance:
+        name, value = item.split("=")
+        if name not in tolerances:
+            parser.error("unknown metric " + name)
+        tolerances[name] = float(value)
+
+    selected = [s for s in scenarios if not args.scenario or s[0] in args.scenario]
+    if not selected:
+        parser.error("no scenario named " + ", ".join(args.scenario))
+
+    if not args.no_build:
+        subprocess.run(["./waf", "build"], cwd=args.ns3, check=True, stdout=subprocess.DEVNULL)
+
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        results = dict(zip([s[0] for s in selected],
+                           pool.map(lambda s: run_scenario(args.ns3, s, args.args), selected)))
+
+    baselines = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as baseline_file:
+            baselines = json.load(baseline_file)
+
+    if args.update:
+        baselines.update(results)
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(baselines, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("Stored baselines of %s in %s" % (", ".join(results.keys()), args.baseline))
+        return 0
+
+    # Without a baseline nothing is compared, which must not pass as a clean run
+    missing = []
+    for name, _, _, _ in selected:
+        baseline = baselines.get(name, {})
+        missing += ["%s %s" % (name, key) for key in results[name] if key not in baseline]
+
+    failed = 0
+    print("%-12s %-24s %12s %12s %9s  %s" % ("Scenario", "Metric", "Baseline", "Current", "Change", "Result"))
+    for name, _, _, _ in selected:
+        current = results[name]
+        baseline = baselines.get(name, {})
+        for metric in metrics:
+            key = metric[0]
+            if key not in current:
+                continue
+            value = current[key]
+            if key not in baseline:
+                print("%-12s %-24s %12s %12.4f %9s  %s" % (name, metric[1], "-", value, "-", "NEW"))
+                continue
+            result = compare(metric, value, baseline[key], tolerances[key])
+            change = (value - baseline[key]) / abs(baseline[key]) * 100 if baseline[key] != 0 else math.inf
+            print("%-12s %-24s %12.4f %12.4f %8.1f%%  %s" % (name, metric[1], baseline[key], value, change, result))
+            if result == "FAIL":
+                failed += 1
+
+    if missing:
+        print("FAIL: no baseline for %s in %s, store them with --update from a reference build" % (
+            ", ".join(missing), args.baseline))
+        return 1
+    print("%s: %d regression(s) in %d scenario(s)" % ("FAIL" if failed else "PASS", failed, len(selected)))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
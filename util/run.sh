@@ -2,6 +2,7 @@
 
 # Put project files in "scratch/.PP"
 # Put run.sh file in "scratch"
+# Put PersonalProject.cc, Loopback.cc and MultiFlowBench.cc in "scratch"
 
 cd ..
 
@@ -17,5 +18,81 @@ topo_file="${project_path}/data/simple_topo.txt"
 # flow_file="${project_path}/data/complicated_flow.txt"
 # topo_file="${project_path}/data/complicated_topo.txt"
 
+# Short flows (Poisson and on/off arrivals)
+# flow_file="${project_path}/data/short_flow.txt"
+# topo_file="${project_path}/data/simple_topo.txt"
+
+# Time-varying bottleneck (cellular.mahi, wifi_fading.txt or handover.txt trace in data/traces)
+# flow_file="${project_path}/data/simple_flow.txt"
+# topo_file="${project_path}/data/cellular_topo.txt"
+# topo_file="${project_path}/data/wifi_topo.txt"
+# topo_file="${project_path}/data/handover_topo.txt"
+
+# Mid-run path changes: recovery of the delay filters (compare the throughput after 30 s and 60 s)
+# flow_file="${project_path}/data/simple_flow.txt"
+# topo_file="${project_path}/data/route_change_topo.txt"
+# topo_file="${project_path}/data/capacity_dip_topo.txt"
+
+# Per-link buffers: shallow RED switch link in series with a deep-buffered access link
+# flow_file="${project_path}/data/buffer_flow.txt"
+# topo_file="${project_path}/data/buffer_topo.txt"
+
+# Feedback under reverse TCP load (compare with --compact_feedback=1 --feedback_tos=16 for feedback delay and interval deviation)
+# flow_file="${project_path}/data/reverse_flow.txt"
+# topo_file="${project_path}/data/simple_topo.txt"
+
+# Return path blackout from 30 s to 35 s (compare --feedback_watchdog=1 with 0 for the bottleneck queue and loss)
+# flow_file="${project_path}/data/simple_flow.txt"
+# topo_file="${project_path}/data/feedback_loss_topo.txt"
+
+# Large generated scenario (1000 nodes, util/gen_topo.py), (SETUP) lines give the setup time per phase
+# flow_file="${project_path}/data/large_flow.txt"
+# topo_file="${project_path}/data/large_topo.txt"
+
+# Dumbbells of 4, 8 or 16 sender/receiver pairs with mixed TCP/UDP (util/gen_topo.py --shape dumbbell)
+# flow_file="${project_path}/data/dumbbell8_flow.txt"
+# topo_file="${project_path}/data/dumbbell8_topo.txt"
+
+# UDP flows against mixed TCP variants and profiles (bulk Bic and Vegas, on/off, request/response)
+# flow_file="${project_path}/data/cross_flow.txt"
+# topo_file="${project_path}/data/dumbbell8_topo.txt"
+
 ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time}" 2>scratch/log.out
+# Multipath UDP flows over link-disjoint paths (compare with --multipath=1 for the aggregate gain)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --multipath=2" 2>scratch/log.out
+# Reliable UDP transfer with NACK-based retransmission (compare completion time with the TCP flows)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --reliable=1" 2>scratch/log.out
+# In-flight cap at twice the bandwidth-delay product (tail delay and loss under sudden congestion, e.g. capacity_dip_topo.txt)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --inflight_cap=1 --inflight_gain=2" 2>scratch/log.out
+# Back off the UDP rate while feedback is missing (e.g. feedback_loss_topo.txt), with the backoffs per flow
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --feedback_watchdog=1 --delay_percentiles=1" 2>scratch/log.out
+# Stop early once every flow is done or idle, or once all flows are steady for 10 s (results over the simulated time)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --auto_stop=1 --converge_window=10 --converge_band=0.05" 2>scratch/log.out
+# Packets sized to the sending rate up to the MTU (fewer packets at high rates, finer pacing at low rates)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --adaptive_size=1" 2>scratch/log.out
+# Which rules of the UDP rate controller fired and how they moved the interval, with every 100th decision logged
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --decision_stats=1 --decision_log=100" 2>scratch/log.out
+# Flight recorder of the last 2048 packets per UDP flow, dumped when a packet is delayed over 50 ms and at the end
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --flight_recorder=2048 --flight_trigger=50 --flight_file=scratch/flight.bin" 2>scratch/log.out
+# python3 ${project_path}/util/flight.py scratch/flight.bin --summary
+# Utilization, queue length, sojourn time and drops of every link, and the bottleneck links (samples every 10 ms)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --link_stats=1 --link_sample=10 --link_trace=scratch/links.bin" 2>scratch/log.out
+# python3 ${project_path}/util/links.py scratch/links.bin
+# UDP flows start from the controller state of earlier flows to the same destination, carried across runs in a file
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --warm_start=1 --warm_start_file=scratch/warm.txt" 2>scratch/log.out
+# Interactive video at 60 fps with a 150 ms playout deadline (frames, latency percentiles and stalls per UDP flow)
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --frame_rate=60 --frame_deadline=150" 2>scratch/log.out
+# Real-socket run of the controller over loopback with a user-space 20 Mbps bottleneck (pps and CPU per Gbit)
+# ./waf --run "scratch/Loopback --bandwidth=20Mbps --delay=10ms --queue=50 --duration=10"
+# Same at 1 Gbps with bursts of 32 packets per controller interval, so that GSO/sendmmsg batches form
+# ./waf --run "scratch/Loopback --bandwidth=1Gbps --delay=1ms --queue=1000 --duration=10 --burst=32"
+# Cost of 200 UDP flows from one host: one UdpClient each against one UdpMultiClient (wall-clock and memory)
+# ./waf --run "scratch/MultiFlowBench --flows=200 --multi=0"
+# ./waf --run "scratch/MultiFlowBench --flows=200 --multi=1"
+# One multiplexed UdpServer port for 2000 senders
+# ./waf --run "scratch/MultiFlowBench --flows=2000 --multi=0 --shared_server=1"
+# Live per-flow metrics, start "python3 util/metrics_view.py --socket=/tmp/netp-metrics.sock" in another terminal first
+# ./waf --run "scratch/PersonalProject --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time} --metrics_socket=/tmp/netp-metrics.sock" 2>scratch/log.out
+# Regression suite over simple, complicated and the dumbbell scenarios (pass/fail and a diff against util/regress_baseline.json)
+# python3 ${project_path}/util/regress.py --jobs=4
 # ./waf --run "scratch/PersonalProject" --command-template="gdb --args %s --flow_file=${flow_file} --topo_file=${topo_file} --sim_time=${sim_time}" 2>scratch/log.out